@@ -0,0 +1,237 @@
+#pragma once
+#include "ConcurrentHashTable.h"
+
+// CLOCK (second chance) eviction policy
+// Entries occupy slots of a ring, every slot has a reference bit which is set on hit without any locking.
+// Clock hand sweeps the ring clearing reference bits and evicts the first entry which was not referenced since the last sweep.
+template <class KeyType>
+class ClockEviction
+{
+public:
+    using Handle = size_t;                                  // entry slot index
+
+    explicit ClockEviction(const size_t capacity);
+
+    // called concurrently on hit
+    void on_hit(const KeyType& key, const Handle handle) noexcept;
+
+    // called under cache write lock
+    Handle on_insert(const KeyType& key, std::vector<KeyType>& evicted);
+    void on_erase(const KeyType& key, const Handle handle) noexcept;
+    void clear() noexcept;
+
+private:
+    struct Slot
+    {
+        KeyType _key = KeyType();
+        bool _used = false;
+    };
+
+    std::vector<Slot> _slots;                               // entries ring
+    std::unique_ptr<std::atomic<uint8_t>[]> _referenced;    // slots reference bits
+    std::vector<size_t> _free_slots;                        // unused slots
+    size_t _hand = 0;                                       // clock hand position
+};
+
+// constructor
+// @capacity - maximal entries number
+template <class KeyType>
+ClockEviction<KeyType>::ClockEviction(const size_t capacity) :
+    _slots(capacity ? capacity : 1),
+    _referenced(new std::atomic<uint8_t>[_slots.size()])
+{
+    clear();
+}
+
+// mark entry as referenced
+// bit is written only if it is not set yet, so hot entries don't bounce the cache line between cores
+// @handle - entry slot, it might be already reused by another entry, which only gives that entry a second chance
+template <class KeyType>
+void ClockEviction<KeyType>::on_hit(const KeyType&, const Handle handle) noexcept
+{
+    if (!_referenced[handle].load(std::memory_order_relaxed))
+        _referenced[handle].store(1, std::memory_order_relaxed);
+}
+
+// place new entry into a free slot, evicting an entry if there are no free slots
+// @key - new entry key
+// @evicted - will contain keys of evicted entries
+template <class KeyType>
+typename ClockEviction<KeyType>::Handle ClockEviction<KeyType>::on_insert(const KeyType& key, std::vector<KeyType>& evicted)
+{
+    size_t slot_idx;
+
+    if (!_free_slots.empty())
+    {
+        slot_idx = _free_slots.back();
+        _free_slots.pop_back();
+    }
+    else
+    {
+        // sweep giving referenced entries a second chance, it stops within two rounds at most
+        while (_referenced[_hand].exchange(0, std::memory_order_relaxed))
+            _hand = (_hand + 1) % _slots.size();
+
+        slot_idx = _hand;
+        _hand = (_hand + 1) % _slots.size();
+        evicted.push_back(_slots[slot_idx]._key);
+    }
+
+    _slots[slot_idx]._key = key;
+    _slots[slot_idx]._used = true;
+    _referenced[slot_idx].store(0, std::memory_order_relaxed);
+    return slot_idx;
+}
+
+// free entry slot
+// @handle - entry slot
+template <class KeyType>
+void ClockEviction<KeyType>::on_erase(const KeyType&, const Handle handle) noexcept
+{
+    if (!_slots[handle]._used)
+        return;
+
+    _slots[handle]._used = false;
+    _free_slots.push_back(handle);
+}
+
+// free all slots
+template <class KeyType>
+void ClockEviction<KeyType>::clear() noexcept
+{
+    _free_slots.clear();
+    for (size_t i = _slots.size(); i > 0; --i)
+    {
+        _slots[i - 1]._used = false;
+        _referenced[i - 1].store(0, std::memory_order_relaxed);
+        _free_slots.push_back(i - 1);
+    }
+    _hand = 0;
+}
+
+// Bounded concurrent cache built on top of concurrent hash table
+// Entries number never exceeds capacity, the entry chosen by eviction policy is evicted to make room for a new one.
+// Hits only read the hashtable under shared locks and notify eviction policy without locking,
+// writes are serialized by the cache write mutex, which is never taken on the hit path.
+template <class KeyType, class ValType, class EvictionPolicy = ClockEviction<KeyType>>
+class ConcurrentCache
+{
+public:
+    explicit ConcurrentCache(const size_t capacity);
+
+    // data access methods
+    size_t size() const noexcept { return _table.size(); }
+    size_t capacity() const noexcept { return _capacity; }
+    bool contains(const KeyType& key) const noexcept { return _table.contains(key); }
+    bool find(const KeyType& key, ValType& val);
+    ValType at(const KeyType& key);
+    void insert(const KeyType& key, const ValType& val);
+    void erase(const KeyType& key);
+    void clear();
+
+private:
+    using Handle = typename EvictionPolicy::Handle;
+
+    // hashtable value, keeps entry handle to notify eviction policy on hit without looking the entry up
+    struct Entry
+    {
+        ValType _val;
+        Handle _handle;
+    };
+
+    size_t _capacity;                                       // maximal entries number
+    ConcurrentHashTable<KeyType, Entry> _table;             // cache entries
+    EvictionPolicy _policy;                                 // eviction policy
+    std::mutex _write_mutex;                                // serializes writes and eviction policy updates
+    std::vector<KeyType> _evicted;                          // evicted keys buffer, used under write mutex
+};
+
+// constructor
+// hashtable is created big enough never to be rehashed
+// @capacity - maximal entries number
+template <class KeyType, class ValType, class EvictionPolicy>
+ConcurrentCache<KeyType, ValType, EvictionPolicy>::ConcurrentCache(const size_t capacity) :
+    _capacity(capacity ? capacity : 1),
+    _table(_capacity * 2 + 1),
+    _policy(_capacity)
+{
+}
+
+// get copy of entry value by key
+// @key - entry key
+// @val - will contain value if found
+template <class KeyType, class ValType, class EvictionPolicy>
+bool ConcurrentCache<KeyType, ValType, EvictionPolicy>::find(const KeyType& key, ValType& val)
+{
+    Entry entry;
+    if (!_table.find(key, entry))
+        return false;
+
+    _policy.on_hit(key, entry._handle);
+    val = std::move(entry._val);
+    return true;
+}
+
+// get copy of entry value by key
+// if entry with specified key not found exception will be thrown
+// @key - entry key
+template <class KeyType, class ValType, class EvictionPolicy>
+ValType ConcurrentCache<KeyType, ValType, EvictionPolicy>::at(const KeyType& key)
+{
+    ValType val;
+    if (!find(key, val))
+        throw std::out_of_range("Key not found");
+    return val;
+}
+
+// insert entry, evicting other entries if capacity is exceeded
+// @key - entry key
+// @val - entry value
+template <class KeyType, class ValType, class EvictionPolicy>
+void ConcurrentCache<KeyType, ValType, EvictionPolicy>::insert(const KeyType& key, const ValType& val)
+{
+    std::lock_guard<std::mutex> write_lock(_write_mutex);
+
+    // update existing entry keeping its place in eviction policy
+    Entry entry;
+    if (_table.find(key, entry))
+    {
+        entry._val = val;
+        _table.insert(key, entry);
+        return;
+    }
+
+    entry._val = val;
+    entry._handle = _policy.on_insert(key, _evicted);
+
+    for (const KeyType& evicted_key : _evicted)
+        _table.erase(evicted_key);
+    _evicted.clear();
+
+    _table.insert(key, entry);
+}
+
+// delete entry
+// @key - entry key
+template <class KeyType, class ValType, class EvictionPolicy>
+void ConcurrentCache<KeyType, ValType, EvictionPolicy>::erase(const KeyType& key)
+{
+    std::lock_guard<std::mutex> write_lock(_write_mutex);
+
+    Entry entry;
+    if (!_table.find(key, entry))
+        return;
+
+    _policy.on_erase(key, entry._handle);
+    _table.erase(key);
+}
+
+// delete all entries
+template <class KeyType, class ValType, class EvictionPolicy>
+void ConcurrentCache<KeyType, ValType, EvictionPolicy>::clear()
+{
+    std::lock_guard<std::mutex> write_lock(_write_mutex);
+
+    _table.clear();
+    _policy.clear();
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "ConcurrentHashCore.h"
+
+// counter map item, counter is atomic so that it can be updated under item read lock
+template <class KeyType, class ValType>
+struct CounterMapItem
+{
+    KeyType _key;
+    mutable std::atomic<ValType> _val;
+    CounterMapItem* _next = nullptr;
+    CounterMapItem(const KeyType& key, const ValType val) noexcept : _key(key), _val(val) {}
+};
+
+// Concurrent (thread safe) map of integral counters
+// Existing counters are incremented with a single lookup under shared locks and an atomic add,
+// only the first increment of a key takes the write path to insert it.
+template <class KeyType, class ValType, class LockPolicy = StripedLocks>
+class ConcurrentCounterMap : public ConcurrentHashCore<KeyType, CounterMapItem<KeyType, ValType>, LockPolicy>
+{
+    // atomic fetch_add exists for integral types only (C++17), and bool is not a counter
+    static_assert(std::is_integral<ValType>::value && !std::is_same<ValType, bool>::value, "counter value must be integral");
+
+private:
+    using Item = CounterMapItem<KeyType, ValType>;
+    using Core = ConcurrentHashCore<KeyType, Item, LockPolicy>;
+
+public:
+    // constructor
+    ConcurrentCounterMap(const size_t capacity = 31,
+                         const float max_load_factor = 0.5,
+                         const float capacity_step = 2.0,
+                         const float lock_factor = (float)std::thread::hardware_concurrency()) noexcept :
+        Core(capacity, max_load_factor, capacity_step, lock_factor) {}
+
+    // data access methods
+    bool contains(const KeyType& key) const noexcept { return this->read_item(key, [](const Item&) { return true; }); }
+    ValType get(const KeyType& key) const noexcept;
+    ValType increment(const KeyType& key, const ValType delta = 1) noexcept;
+    bool erase(const KeyType& key) noexcept { return this->erase_item(key); }
+
+    // iteration methods
+    template <class Func> void for_each(Func fn) const;
+};
+
+// get counter value
+// @key - counter key
+// returns 0 if counter not found
+template <class KeyType, class ValType, class LockPolicy>
+ValType ConcurrentCounterMap<KeyType, ValType, LockPolicy>::get(const KeyType& key) const noexcept
+{
+    ValType res = 0;
+    this->read_item(key, [&](const Item& item) { res = item._val.load(std::memory_order_relaxed); return true; });
+    return res;
+}
+
+// add delta to counter, counter is created if it doesn't exist
+// @key - counter key
+// @delta - value to add
+// returns new counter value
+template <class KeyType, class ValType, class LockPolicy>
+ValType ConcurrentCounterMap<KeyType, ValType, LockPolicy>::increment(const KeyType& key, const ValType delta) noexcept
+{
+    ValType res = delta;
+
+    // existing counter is updated under read locks
+    if (this->read_item(key, [&](const Item& item) { res = item._val.fetch_add(delta, std::memory_order_relaxed) + delta; return true; }))
+        return res;
+
+    // key is new, but it might have been inserted by another thread meanwhile
+    this->write_item(key, [&](Item& item) { res = item._val.fetch_add(delta, std::memory_order_relaxed) + delta; }, key, delta);
+    return res;
+}
+
+// visit all counters stripe by stripe, iteration is weakly consistent: every counter which stays in map meanwhile is visited exactly once
+// @fn - visitor, called as fn(const KeyType& key, ValType val)
+template <class KeyType, class ValType, class LockPolicy>
+template <class Func>
+void ConcurrentCounterMap<KeyType, ValType, LockPolicy>::for_each(Func fn) const
+{
+    this->for_each_item([&](const Item& item) { fn(item._key, item._val.load(std::memory_order_relaxed)); });
+}
@@ -0,0 +1,834 @@
+#pragma once
+#include "WorkStealingRange.h"
+#include "StripedCounter.h"
+#include "Locks.h"
+#include "Memory.h"
+
+// Concurrent hash table core
+// Implements buckets, locking, items counting and rehashing for any item type, containers built on top of it
+// (ConcurrentHashTable, ConcurrentHashSet, ConcurrentHashMultimap) define what an item stores and how it is accessed.
+// Item type must have _key and _next members.
+// LockPolicy defines how buckets are locked, either by striped mutexes (StripedLocks) or by spin locks embedded into buckets (BucketLocks).
+// It also defines the resize and global mutexes types, e.g. CustomLocks<DistributedRWLock, TicketLock> for tables with hot stripes.
+// Item operations take only the resize mutex shared, which touches a per-core counter by default, and the item mutex, so operations
+// on different stripes run in parallel. Whole hashtable operations (rehashing, clearing) take the global mutex and then the resize mutex
+// exclusively, which waits for running item operations, and iterations take the global mutex shared and item mutexes stripe by stripe.
+// MemoryPolicy defines where buckets and items are allocated, either in the default heap (HeapMemory) or NUMA aware (NumaMemory).
+template <class KeyType, class Item, class LockPolicy = StripedLocks, class MemoryPolicy = HeapMemory>
+class ConcurrentHashCore
+{
+public:
+    // constructor/destructor
+    ConcurrentHashCore(const size_t capacity,
+                       const float max_load_factor,
+                       const float capacity_step,
+                       const float lock_factor,
+                       const MemoryPolicy& memory = MemoryPolicy()) noexcept;
+    ~ConcurrentHashCore() noexcept;
+
+    // data access methods
+    size_t size() const noexcept { return _size.approximate(); }
+    size_t size_exact() const noexcept;
+    size_t capacity() const noexcept { return _capacity; }
+    void clear() noexcept;
+    void reserve(const size_t items_num) noexcept;
+    const MemoryPolicy& memory() const noexcept { return _memory; }
+    size_t stripes_num() const noexcept;
+
+protected:
+    using ResizeMutex = typename LockPolicy::ResizeMutex;
+    using GlobalMutex = typename LockPolicy::GlobalMutex;
+    using ItemMutex = typename LockPolicy::ItemMutex;
+
+    // bucket with striped items mutexes
+    struct Bucket
+    {
+        Item* _head = nullptr;
+    };
+
+    // bucket with its own embedded mutex
+    struct LockedBucket
+    {
+        Item* _head = nullptr;
+        mutable ItemMutex _mutex;
+    };
+
+    // bucket with storage for its first item (inline memory policies only)
+    template <class BaseBucket>
+    struct InlineBucket : BaseBucket
+    {
+        alignas(Item) unsigned char _slot[sizeof(Item)];
+        bool _slot_used = false;
+        Item* slot() noexcept { return reinterpret_cast<Item*>(_slot); }
+    };
+
+    static constexpr bool _inline_items = is_inline_memory<MemoryPolicy>::value;
+    using BaseBucketType = std::conditional_t<LockPolicy::embedded, LockedBucket, Bucket>;
+    using BucketType = std::conditional_t<_inline_items, InlineBucket<BaseBucketType>, BaseBucketType>;
+
+    MemoryPolicy _memory;                                   // buckets and items allocator, destroyed after them
+    BucketType* _items;                                     // hashtable items
+    StripedCounter _size;                                   // hashtable items number
+    size_t _capacity;                                       // hashtable capacity
+    float _max_load_factor;                                 // hashtable maximal load factor
+    float _capacity_step;                                   // capacity increase coefficient
+    float _lock_factor;                                     // hashtable items number to item mutexes number ratio, initial one
+    mutable GlobalMutex _global_mutex;                      // global entire hashtable level mutex
+    mutable ResizeMutex _resize_lock;                       // taken shared by item operations and exclusively by resizing
+    std::atomic<size_t> _rehash_threshold;                  // items number, hashtable is rehashed when it is exceeded
+    mutable std::deque<ItemMutex> _items_mutexes;           // items mutexes collection to lock hashtable on particular item level (striped locks only)
+    mutable StripedCounter _acquisitions;                   // item mutexes acquisitions since the last rehashing
+    mutable StripedCounter _contentions;                    // contended item mutexes acquisitions since the last rehashing
+
+    // item access methods
+    template <class Func> bool read_item(const KeyType& key, Func fn) const;
+    template <class Update, class... Args> bool write_item(const KeyType& key, Update update, Args&&... args);
+    template <class Update, class Written, class... Args> bool write_item_notify(const KeyType& key, Update update, Written written, Args&&... args);
+    bool erase_item(const KeyType& key) noexcept;
+    template <class Pred> bool erase_item_if(const KeyType& key, Pred pred);
+    template <class Pred> size_t erase_items_if(Pred pred);
+    template <class Arg, class Pred> size_t erase_items_batch(const std::vector<std::pair<KeyType, Arg>>& keys, Pred pred);
+
+    // items iteration methods
+    template <class Func> void for_each_item(Func fn) const;
+    template <class Func> void parallel_for_each_item(const size_t threads_num, Func fn) const;
+    template <class Func> void clear_items(Func fn);
+
+    // allocation methods
+    template <class... Args> Item* create_item(BucketType& bucket, Args&&... args);
+    void destroy_item(Item* item) noexcept;
+    bool is_inline(const Item* item, const BucketType* buckets, const size_t capacity) const noexcept;
+    BucketType* create_buckets(const size_t capacity);
+    void destroy_buckets(BucketType* buckets, const size_t capacity) noexcept;
+
+    // auxiliary methods
+    size_t bucket_index(const KeyType& key) const noexcept { return std::hash<KeyType>()(key) % _capacity; }
+    bool get_item(const KeyType& key, const size_t bucket_idx, Item**& item) const noexcept;
+    size_t locks_num() const noexcept;
+    ItemMutex& item_mutex(const size_t item_idx) const noexcept;
+    template <class Lock> void lock_item(Lock& item_lock) const noexcept;
+
+private:
+    static const size_t _parallel_chunk_size = 1024;        // buckets number handed out to a parallel worker at once
+    static constexpr size_t _min_acquisitions = 4096;       // item mutexes acquisitions enough to judge contention
+    static constexpr float _max_contention = 1.0f / 64;     // contended acquisitions ratio, above which stripes number is doubled
+    static constexpr float _min_contention = 1.0f / 4096;   // contended acquisitions ratio, below which stripes number is halved
+
+    template <class Func> void visit_items(const size_t begin, const size_t end, size_t worker_idx, Func& fn) const;
+    template <class Func> void run_workers(const size_t threads_num, Func worker) const;
+    void free_items() noexcept;
+    void try_rehash() noexcept;
+    void rehash(const size_t capacity) noexcept;
+    Item* relocate_item(Item* item, BucketType& new_bucket, const BucketType* old_buckets, const size_t old_capacity);
+    void update_thresholds() noexcept;
+    void add_mutexes() noexcept;
+    void resize_mutexes() noexcept;
+};
+
+// constructor
+// @capacity - initial hashtable capacity
+// @max_load_factor - maximal hashtable load factor, used to determine that rehashing is needed
+// @capacity_step - capacity step, used to increase capacity while rehashing
+// @lock_factor - initial hashtable items number to item mutexes number ratio, stripes number follows contention after that
+// @memory - buckets and items allocator
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::ConcurrentHashCore(const size_t capacity,
+                                                                                const float max_load_factor,
+                                                                                const float capacity_step,
+                                                                                const float lock_factor,
+                                                                                const MemoryPolicy& memory) noexcept :
+    _memory(memory),
+    _capacity(capacity),
+    _max_load_factor(max_load_factor),
+    _capacity_step(capacity_step),
+    _lock_factor(lock_factor)
+{
+    _items = create_buckets(_capacity);
+    add_mutexes();
+    update_thresholds();
+
+    // contention counters are read only while rehashing, so they are folded rarely
+    _acquisitions.set_batch(256);
+    _contentions.set_batch(16);
+}
+
+// destructor
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::~ConcurrentHashCore() noexcept
+{
+    free_items();
+    destroy_buckets(_items, _capacity);
+}
+
+// get exact items number
+// counter is updated by item operations and batch erase under resize lock, and by bulk erase under global lock, so both are taken
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+size_t ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::size_exact() const noexcept
+{
+    std::unique_lock<GlobalMutex> global_lock(_global_mutex);
+    std::unique_lock<ResizeMutex> resize_lock(_resize_lock);
+    return _size.exact();
+}
+
+// delete all items
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::clear() noexcept
+{
+    clear_items([] {});
+}
+
+// delete all items and call a function while the whole hashtable is still locked
+// @fn - function, called as fn() after items are deleted
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+template <class Func>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::clear_items(Func fn)
+{
+    std::unique_lock<GlobalMutex> global_lock(_global_mutex);
+    std::unique_lock<ResizeMutex> resize_lock(_resize_lock);
+
+    free_items();
+    _size.reset();
+    fn();
+}
+
+// grow capacity to hold specified items number without rehashing
+// @items_num - expected items number
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::reserve(const size_t items_num) noexcept
+{
+    std::unique_lock<GlobalMutex> global_lock(_global_mutex);
+    std::unique_lock<ResizeMutex> resize_lock(_resize_lock);
+
+    size_t capacity = (size_t)std::ceil(items_num / _max_load_factor) + 1;
+    if (capacity > _capacity)
+        rehash(capacity);
+}
+
+// read item by key
+// @key - item key
+// @fn - called as fn(const Item& item) under item read lock if item is found, returns whether item is visible
+// returns false if item not found or not visible
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+template <class Func>
+bool ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::read_item(const KeyType& key, Func fn) const
+{
+    std::shared_lock<ResizeMutex> resize_lock(_resize_lock);
+
+    size_t bucket_idx = bucket_index(key);
+    std::shared_lock<ItemMutex> item_lock(item_mutex(bucket_idx), std::defer_lock);
+    lock_item(item_lock);
+
+    Item** item;
+    if (!get_item(key, bucket_idx, item))
+        return false;
+
+    return fn(**item);
+}
+
+// update existing item or insert a new one
+// @key - item key
+// @update - called as update(Item& item) under item write lock if item is found
+// @args - new item constructor arguments, used if item is not found
+// returns true if a new item was inserted
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+template <class Update, class... Args>
+bool ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::write_item(const KeyType& key, Update update, Args&&... args)
+{
+    return write_item_notify(key, update, [](Item&) {}, std::forward<Args>(args)...);
+}
+
+// update existing item or insert a new one and notify about it while item is still locked,
+// so that notifications about writes of the same item come in the same order as the writes
+// @key - item key
+// @update - called as update(Item& item) under item write lock if item is found
+// @written - called as written(Item& item) under item write lock after item is updated or inserted
+// @args - new item constructor arguments, used if item is not found
+// returns true if a new item was inserted
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+template <class Update, class Written, class... Args>
+bool ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::write_item_notify(const KeyType& key, Update update, Written written, Args&&... args)
+{
+    try_rehash(); // try to rehash table
+
+    // only the item bucket is locked, resize lock just keeps buckets and mutexes in place
+    std::shared_lock<ResizeMutex> resize_lock(_resize_lock);
+    size_t bucket_idx = bucket_index(key);
+    std::unique_lock<ItemMutex> item_lock(item_mutex(bucket_idx), std::defer_lock);
+    lock_item(item_lock);
+
+    Item** item;
+    bool item_found = get_item(key, bucket_idx, item);
+
+    // update item if found or insert a new item if not found
+    if (item_found)
+        update(**item);
+    else
+    {
+        *item = create_item(_items[bucket_idx], std::forward<Args>(args)...);
+        _size.add(1);
+    }
+
+    written(**item);
+    return !item_found;
+}
+
+// delete item
+// @key - item key
+// returns true if item was found and deleted
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+bool ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::erase_item(const KeyType& key) noexcept
+{
+    return erase_item_if(key, [](Item&) { return true; });
+}
+
+// delete item if it matches predicate
+// @key - item key
+// @pred - called as pred(Item& item) under item write lock, might modify the item, item is deleted if it returns true
+// returns true if item was found and deleted
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+template <class Pred>
+bool ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::erase_item_if(const KeyType& key, Pred pred)
+{
+    std::shared_lock<ResizeMutex> resize_lock(_resize_lock);
+    size_t bucket_idx = bucket_index(key);
+    std::unique_lock<ItemMutex> item_lock(item_mutex(bucket_idx), std::defer_lock);
+    lock_item(item_lock);
+
+    Item** item;
+    if (!get_item(key, bucket_idx, item) || !pred(**item))
+        return false;
+
+    _size.add(-1);
+
+    // delete item from chain
+    Item* erased_item = *item;
+    *item = erased_item->_next;
+    destroy_item(erased_item);
+    return true;
+}
+
+// delete all items matching predicate in a single sweep
+// buckets are swept stripe by stripe under item write locks while rehashing waits, so writers of other stripes are not blocked,
+// and every item which stays in hashtable meanwhile is checked exactly once,
+// items count is adjusted once per stripe and erased items are freed after the stripe lock is released
+// @pred - called as pred(const Item& item), item is erased if it returns true
+// returns erased items number
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+template <class Pred>
+size_t ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::erase_items_if(Pred pred)
+{
+    size_t erased_num = 0;
+    size_t inline_erased_num = 0;
+    std::vector<Item*> erased_items;
+
+    // items count is adjusted under global lock, so that size_exact doesn't see it ahead of or behind the buckets
+    std::shared_lock<GlobalMutex> global_lock(_global_mutex);
+    size_t stripes_num = locks_num();
+
+    for (size_t lock_idx = 0; lock_idx < stripes_num; ++lock_idx)
+    {
+        {
+            // unlink matching items in place
+            std::unique_lock<ItemMutex> item_lock(item_mutex(lock_idx));
+            for (size_t i = lock_idx; i < _capacity; i += stripes_num)
+            {
+                Item** item = &_items[i]._head;
+                while (*item)
+                {
+                    if (pred(static_cast<const Item&>(**item)))
+                    {
+                        Item* erased_item = *item;
+                        *item = erased_item->_next;
+
+                        // inline item storage belongs to the bucket, so it is freed under the lock
+                        if (is_inline(erased_item, _items, _capacity))
+                        {
+                            destroy_item(erased_item);
+                            inline_erased_num++;
+                        }
+                        else
+                            erased_items.push_back(erased_item);
+                    }
+                    else
+                        item = &(*item)->_next;
+                }
+            }
+        }
+
+        if (erased_items.empty() && !inline_erased_num)
+            continue;
+
+        _size.add(-(ptrdiff_t)(erased_items.size() + inline_erased_num));
+
+        // free erased items outside of the stripe lock
+        for (Item* item : erased_items)
+            destroy_item(item);
+
+        erased_num += erased_items.size() + inline_erased_num;
+        erased_items.clear();
+        inline_erased_num = 0;
+    }
+
+    return erased_num;
+}
+
+// delete items of several keys if they match predicate
+// keys are grouped by stripes, so that every stripe is locked once for all of its keys, and resize lock is held meanwhile,
+// so that stripes don't change; items count is adjusted once under resize lock and erased items are freed after locks are released
+// @keys - pairs of item key and predicate argument
+// @pred - called as pred(Item& item, const Arg& arg) under item write lock, might modify the item, item is deleted if it returns true
+// returns deleted items number
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+template <class Arg, class Pred>
+size_t ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::erase_items_batch(const std::vector<std::pair<KeyType, Arg>>& keys, Pred pred)
+{
+    size_t erased_num = 0;
+    std::vector<Item*> erased_items;
+    {
+        std::shared_lock<ResizeMutex> resize_lock(_resize_lock);
+        size_t stripes_num = locks_num();
+
+        // pairs of key bucket and key index, ordered by stripes
+        std::vector<std::pair<size_t, size_t>> buckets(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i)
+            buckets[i] = { bucket_index(keys[i].first), i };
+        std::sort(buckets.begin(), buckets.end(), [stripes_num](const auto& a, const auto& b) { return a.first % stripes_num < b.first % stripes_num; });
+
+        for (size_t first = 0; first < buckets.size(); )
+        {
+            size_t stripe = buckets[first].first % stripes_num;
+            std::unique_lock<ItemMutex> item_lock(item_mutex(buckets[first].first), std::defer_lock);
+            lock_item(item_lock);
+
+            for (; first < buckets.size() && buckets[first].first % stripes_num == stripe; ++first)
+            {
+                const std::pair<KeyType, Arg>& key = keys[buckets[first].second];
+                Item** item;
+                if (!get_item(key.first, buckets[first].first, item) || !pred(**item, key.second))
+                    continue;
+
+                Item* erased_item = *item;
+                *item = erased_item->_next;
+                erased_num++;
+
+                // inline item storage belongs to the bucket, so it is freed under the lock
+                if (is_inline(erased_item, _items, _capacity))
+                    destroy_item(erased_item);
+                else
+                    erased_items.push_back(erased_item);
+            }
+        }
+
+        _size.add(-(ptrdiff_t)erased_num);
+    }
+
+    // free erased items outside of locks
+    for (Item* item : erased_items)
+        destroy_item(item);
+
+    return erased_num;
+}
+
+// visit all items stripe by stripe while rehashing waits
+// iteration is weakly consistent: every item which stays in hashtable meanwhile is visited exactly once,
+// and each stripe is visited under its read lock, so it is seen at a single point in time and readers are not blocked,
+// writers are blocked only while their stripe is visited or if they need to rehash the table,
+// changes made to already visited stripes are not seen
+// @fn - visitor, called as fn(const Item& item)
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+template <class Func>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::for_each_item(Func fn) const
+{
+    std::shared_lock<GlobalMutex> global_lock(_global_mutex);
+    size_t stripes_num = locks_num();
+
+    for (size_t lock_idx = 0; lock_idx < stripes_num; ++lock_idx)
+    {
+        std::shared_lock<ItemMutex> item_lock(item_mutex(lock_idx));
+        for (size_t i = lock_idx; i < _capacity; i += stripes_num)
+        {
+            for (const Item* item = _items[i]._head; item; item = item->_next)
+                fn(*item);
+        }
+    }
+}
+
+// visit all items in parallel
+// buckets range is split into chunks which are distributed between threads by work stealing,
+// rehashing waits until all buckets are visited, so every item which stays in hashtable meanwhile is visited exactly once,
+// and every bucket is visited under its read lock, so changes of other buckets are not blocked
+// @threads_num - threads number, including calling thread
+// @fn - visitor, called concurrently as fn(size_t worker_idx, const Item& item), worker_idx is less than threads_num
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+template <class Func>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::parallel_for_each_item(const size_t threads_num, Func fn) const
+{
+    // workers must not take global mutex themselves, as a waiting rehash might block them behind the walk they are part of
+    std::shared_lock<GlobalMutex> global_lock(_global_mutex);
+
+    WorkStealingRange range(0, _capacity, _parallel_chunk_size, threads_num);
+    run_workers(range.workers_num(), [&](size_t worker_idx)
+    {
+        size_t begin, end;
+        while (range.next(worker_idx, begin, end))
+            visit_items(begin, end, worker_idx, fn);
+    });
+}
+
+// visit items of buckets range
+// must be called under global mutex
+// @begin - first bucket
+// @end - past the last bucket
+// @worker_idx - index of visiting worker
+// @fn - visitor
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+template <class Func>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::visit_items(const size_t begin, const size_t end, size_t worker_idx, Func& fn) const
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        std::shared_lock<ItemMutex> item_lock(item_mutex(i));
+        for (const Item* item = _items[i]._head; item; item = item->_next)
+            fn(worker_idx, *item);
+    }
+}
+
+// run worker function in several threads, calling thread is used as the first worker
+// @threads_num - threads number
+// @worker - called as worker(size_t worker_idx)
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+template <class Func>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::run_workers(const size_t threads_num, Func worker) const
+{
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threads_num; ++i)
+        threads.emplace_back(worker, i);
+
+    worker(0);
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+// get item by key
+// must be called under item lock of the bucket
+// @key         searchable item key
+// @bucket_idx  item bucket index
+// @item        will contain item pointer reference if item found and new item pointer reference otherwise
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+bool ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::get_item(const KeyType& key, const size_t bucket_idx, Item**& item) const noexcept
+{
+    bool res = false;
+
+    item = &_items[bucket_idx]._head;
+
+    // find item with given key
+    for (Item* i = *item; i; i = i->_next)
+    {
+        if (i->_key == key)
+        {
+            res = true;
+            break;
+        }
+
+        item = &i->_next;
+    }
+
+    return res;
+}
+
+// allocate and construct item, inline in its bucket if bucket storage is free
+// must be called under item lock
+// @bucket - item bucket
+// @args - item constructor arguments
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+template <class... Args>
+Item* ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::create_item(BucketType& bucket, Args&&... args)
+{
+    if constexpr (_inline_items)
+    {
+        if (!bucket._slot_used)
+        {
+            Item* item = new (bucket.slot()) Item(std::forward<Args>(args)...);
+            bucket._slot_used = true;
+            return item;
+        }
+    }
+    else
+        (void)bucket;
+
+    void* mem = _memory.allocate_item(sizeof(Item), alignof(Item));
+    try
+    {
+        return new (mem) Item(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        _memory.free_item(mem, sizeof(Item));
+        throw;
+    }
+}
+
+// destroy and free item
+// must be called under item lock
+// @item - item
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::destroy_item(Item* item) noexcept
+{
+    item->~Item();
+
+    if constexpr (_inline_items)
+    {
+        if (is_inline(item, _items, _capacity))
+        {
+            _items[((const char*)item - (const char*)_items) / sizeof(BucketType)]._slot_used = false;
+            return;
+        }
+    }
+
+    _memory.free_item(item, sizeof(Item));
+}
+
+// checks whether item is stored inline in buckets array
+// @item - item
+// @buckets - buckets array
+// @capacity - buckets number
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+bool ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::is_inline(const Item* item, const BucketType* buckets, const size_t capacity) const noexcept
+{
+    if constexpr (_inline_items)
+        return (uintptr_t)item >= (uintptr_t)buckets && (uintptr_t)item < (uintptr_t)(buckets + capacity);
+    else
+        return false;
+}
+
+// allocate and construct empty buckets array
+// @capacity - buckets number
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+typename ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::BucketType* ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::create_buckets(const size_t capacity)
+{
+    BucketType* buckets = static_cast<BucketType*>(_memory.allocate_buckets(capacity * sizeof(BucketType)));
+    std::uninitialized_value_construct_n(buckets, capacity);
+    return buckets;
+}
+
+// destroy and free buckets array
+// @buckets - buckets array
+// @capacity - buckets number
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::destroy_buckets(BucketType* buckets, const size_t capacity) noexcept
+{
+    std::destroy_n(buckets, capacity);
+    _memory.free_buckets(buckets, capacity * sizeof(BucketType));
+}
+
+// free all items chains
+// must be called under exclusive global and resize locks
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::free_items() noexcept
+{
+    for (size_t i = 0; i < _capacity; ++i)
+    {
+        while (_items[i]._head)
+        {
+            Item* next_item = _items[i]._head->_next;
+            destroy_item(_items[i]._head);
+            _items[i]._head = next_item;
+        }
+    }
+}
+
+// rehash if load factor is exceeded
+// must be called without locks, as rehashing locks the whole hashtable
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::try_rehash() noexcept
+{
+    // check load factor
+    if (_size.approximate() <= _rehash_threshold.load(std::memory_order_relaxed))
+        return;
+
+    std::unique_lock<GlobalMutex> global_lock(_global_mutex);
+    std::unique_lock<ResizeMutex> resize_lock(_resize_lock);
+
+    // another writer might have rehashed the table meanwhile
+    if ((float)_size.approximate() / (float)_capacity <= _max_load_factor)
+        return;
+
+    rehash(std::lroundf(_capacity * _capacity_step));
+}
+
+// move all items to a new buckets array
+// must be called under exclusive global and resize locks, so no item operation is running
+// @capacity - new capacity
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::rehash(const size_t capacity) noexcept
+{
+    // save old capacity and data
+    size_t old_capacity = _capacity;
+    BucketType* old_items = _items;
+
+    // change capacity and allocate a new hash table
+    _capacity = capacity;
+    _items = create_buckets(_capacity);
+
+    // move items to the new hash table
+    std::hash<KeyType> hash_func;
+    for (size_t i = 0; i < old_capacity; ++i)
+    {
+        Item* old_item = old_items[i]._head;
+        while (old_item)
+        {
+            Item* next_item = old_item->_next;
+            BucketType& new_bucket = _items[hash_func(old_item->_key) % _capacity];
+            old_item = relocate_item(old_item, new_bucket, old_items, old_capacity);
+            old_item->_next = new_bucket._head;
+            new_bucket._head = old_item;
+            old_item = next_item;
+        }
+    }
+
+    resize_mutexes();
+    update_thresholds();
+
+    // free old items
+    destroy_buckets(old_items, old_capacity);
+}
+
+// move item to the new buckets array while rehashing
+// with inline items, item takes storage of its new bucket if it is free, and inline item of the old array moves to heap otherwise,
+// other items are just relinked
+// @item - item
+// @new_bucket - item bucket in the new buckets array
+// @old_buckets - old buckets array
+// @old_capacity - old buckets number
+// returns item at its new place
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+Item* ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::relocate_item(Item* item, BucketType& new_bucket, const BucketType* old_buckets, const size_t old_capacity)
+{
+    if constexpr (_inline_items)
+    {
+        bool was_inline = is_inline(item, old_buckets, old_capacity);
+        if (!new_bucket._slot_used || was_inline)
+        {
+            Item* new_item = create_item(new_bucket, std::move(*item));
+            item->~Item();
+            if (!was_inline)
+                _memory.free_item(item, sizeof(Item));
+            return new_item;
+        }
+    }
+    else
+    {
+        (void)new_bucket;
+        (void)old_buckets;
+        (void)old_capacity;
+    }
+
+    return item;
+}
+
+// set rehashing threshold and size counter batch according to capacity
+// the bigger the table the less precise size is needed to decide whether it should be rehashed,
+// so that the counter error stays within a small fraction of the rehashing threshold
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::update_thresholds() noexcept
+{
+    float rehash_threshold = _capacity * _max_load_factor;
+    _rehash_threshold.store((size_t)rehash_threshold, std::memory_order_relaxed);
+    _size.set_batch((size_t)(rehash_threshold / (8 * _size.cells_num())));
+}
+
+// add initial mutexes for capacity, so that there are lock factor items per mutex at maximal load factor
+// must be called in constructor
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::add_mutexes() noexcept
+{
+    if constexpr (!LockPolicy::embedded)
+    {
+        size_t mutexes_num = std::max<size_t>(1, (size_t)(_capacity * _max_load_factor / _lock_factor));
+        while (_items_mutexes.size() < mutexes_num)
+            _items_mutexes.emplace_back();
+    }
+}
+
+// double or halve mutexes number according to contended acquisitions ratio since the last rehashing
+// stripes number stays between cores number and buckets number, and it is changed only while no item operation is running,
+// as bucket to mutex mapping changes
+// must be called under exclusive global and resize locks
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::resize_mutexes() noexcept
+{
+    if constexpr (!LockPolicy::embedded)
+    {
+        size_t acquisitions = _acquisitions.exact();
+        if (acquisitions < _min_acquisitions)
+            return;
+
+        float contention = (float)_contentions.exact() / (float)acquisitions;
+        size_t mutexes_num = _items_mutexes.size();
+        if (contention > _max_contention)
+            mutexes_num *= 2;
+        else if (contention < _min_contention)
+            mutexes_num /= 2;
+
+        size_t min_mutexes_num = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), _capacity);
+        mutexes_num = std::max(std::min(mutexes_num, _capacity), min_mutexes_num);
+
+        while (_items_mutexes.size() < mutexes_num)
+            _items_mutexes.emplace_back();
+        while (_items_mutexes.size() > mutexes_num)
+            _items_mutexes.pop_back();
+
+        _acquisitions.reset();
+        _contentions.reset();
+    }
+}
+
+// get number of stripes, i.e. items mutexes, every bucket has its own mutex if mutexes are embedded
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+size_t ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::stripes_num() const noexcept
+{
+    std::shared_lock<GlobalMutex> global_lock(_global_mutex);
+    return locks_num();
+}
+
+// get number of items mutexes, every bucket has its own mutex if mutexes are embedded
+// must be called under global or resize lock
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+size_t ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::locks_num() const noexcept
+{
+    if constexpr (LockPolicy::embedded)
+        return _capacity;
+    else
+        return _items_mutexes.size();
+}
+
+// get mutex protecting bucket
+// must be called under global or resize lock
+// @item_idx - bucket index
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+typename ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::ItemMutex& ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::item_mutex(const size_t item_idx) const noexcept
+{
+    if constexpr (LockPolicy::embedded)
+        return _items[item_idx]._mutex;
+    else
+        return _items_mutexes[item_idx % _items_mutexes.size()];
+}
+
+// lock item mutex of item operation and count contended acquisitions, stripes number is adjusted by them while rehashing
+// @item_lock - unique or shared lock of item mutex, not locked yet
+template <class KeyType, class Item, class LockPolicy, class MemoryPolicy>
+template <class Lock>
+void ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>::lock_item(Lock& item_lock) const noexcept
+{
+    if constexpr (!LockPolicy::embedded)
+    {
+        _acquisitions.add(1);
+        if (item_lock.try_lock())
+            return;
+
+        _contentions.add(1);
+    }
+
+    item_lock.lock();
+}
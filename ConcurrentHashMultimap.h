@@ -0,0 +1,104 @@
+#pragma once
+#include "ConcurrentHashCore.h"
+
+// hash multimap item, keeps all values of a key
+template <class KeyType, class ValType>
+struct HashMultimapItem
+{
+    KeyType _key;
+    std::vector<ValType> _vals;
+    HashMultimapItem* _next = nullptr;
+    HashMultimapItem(const KeyType& key, const ValType& val) : _key(key), _vals(1, val) {}
+};
+
+// Concurrent (thread safe) hash multimap class
+// Shares buckets, locking and rehashing with ConcurrentHashTable, every key keeps a list of values,
+// which is appended under the key item lock. Size is the number of keys.
+template <class KeyType, class ValType, class LockPolicy = StripedLocks>
+class ConcurrentHashMultimap : public ConcurrentHashCore<KeyType, HashMultimapItem<KeyType, ValType>, LockPolicy>
+{
+private:
+    using Item = HashMultimapItem<KeyType, ValType>;
+    using Core = ConcurrentHashCore<KeyType, Item, LockPolicy>;
+
+public:
+    // constructor
+    ConcurrentHashMultimap(const size_t capacity = 31,
+                           const float max_load_factor = 0.5,
+                           const float capacity_step = 2.0,
+                           const float lock_factor = (float)std::thread::hardware_concurrency()) noexcept :
+        Core(capacity, max_load_factor, capacity_step, lock_factor) {}
+
+    // data access methods
+    bool contains(const KeyType& key) const noexcept { return this->read_item(key, [](const Item&) { return true; }); }
+    size_t count(const KeyType& key) const;
+    bool find(const KeyType& key, std::vector<ValType>& vals) const;
+    void insert(const KeyType& key, const ValType& val);
+    bool erase(const KeyType& key) noexcept { return this->erase_item(key); }
+    bool erase(const KeyType& key, const ValType& val);
+
+    // iteration methods
+    template <class Func> void for_each(Func fn) const;
+};
+
+// get number of key values
+// @key - values key
+template <class KeyType, class ValType, class LockPolicy>
+size_t ConcurrentHashMultimap<KeyType, ValType, LockPolicy>::count(const KeyType& key) const
+{
+    size_t res = 0;
+    this->read_item(key, [&](const Item& item) { res = item._vals.size(); return true; });
+    return res;
+}
+
+// get copy of key values
+// @key - values key
+// @vals - will contain values if key found
+template <class KeyType, class ValType, class LockPolicy>
+bool ConcurrentHashMultimap<KeyType, ValType, LockPolicy>::find(const KeyType& key, std::vector<ValType>& vals) const
+{
+    return this->read_item(key, [&](const Item& item) { vals = item._vals; return true; });
+}
+
+// append value to the key values
+// @key - values key
+// @val - value to append
+template <class KeyType, class ValType, class LockPolicy>
+void ConcurrentHashMultimap<KeyType, ValType, LockPolicy>::insert(const KeyType& key, const ValType& val)
+{
+    this->write_item(key, [&](Item& item) { item._vals.push_back(val); }, key, val);
+}
+
+// delete one value of the key, key is deleted when its last value is deleted
+// @key - values key
+// @val - value to delete
+// returns true if value was found and deleted
+template <class KeyType, class ValType, class LockPolicy>
+bool ConcurrentHashMultimap<KeyType, ValType, LockPolicy>::erase(const KeyType& key, const ValType& val)
+{
+    bool res = false;
+    this->erase_item_if(key, [&](Item& item)
+    {
+        auto it = std::find(item._vals.begin(), item._vals.end(), val);
+        if (it != item._vals.end())
+        {
+            item._vals.erase(it);
+            res = true;
+        }
+        return item._vals.empty();
+    });
+    return res;
+}
+
+// visit all values stripe by stripe, iteration is weakly consistent: every value which stays in multimap meanwhile is visited exactly once
+// @fn - visitor, called as fn(const KeyType& key, const ValType& val) for every value
+template <class KeyType, class ValType, class LockPolicy>
+template <class Func>
+void ConcurrentHashMultimap<KeyType, ValType, LockPolicy>::for_each(Func fn) const
+{
+    this->for_each_item([&](const Item& item)
+    {
+        for (const ValType& val : item._vals)
+            fn(item._key, val);
+    });
+}
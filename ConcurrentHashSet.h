@@ -0,0 +1,57 @@
+#pragma once
+#include "ConcurrentHashCore.h"
+
+// hashset item, stores key only
+template <class KeyType>
+struct HashSetItem
+{
+    KeyType _key;
+    HashSetItem* _next = nullptr;
+    explicit HashSetItem(const KeyType& key) noexcept : _key(key) {}
+};
+
+// Concurrent (thread safe) hash set class
+// Shares buckets, locking and rehashing with ConcurrentHashTable, but items keep no value.
+template <class KeyType, class LockPolicy = StripedLocks>
+class ConcurrentHashSet : public ConcurrentHashCore<KeyType, HashSetItem<KeyType>, LockPolicy>
+{
+private:
+    using Item = HashSetItem<KeyType>;
+    using Core = ConcurrentHashCore<KeyType, Item, LockPolicy>;
+
+public:
+    // constructor
+    ConcurrentHashSet(const size_t capacity = 31,
+                      const float max_load_factor = 0.5,
+                      const float capacity_step = 2.0,
+                      const float lock_factor = (float)std::thread::hardware_concurrency()) noexcept :
+        Core(capacity, max_load_factor, capacity_step, lock_factor) {}
+
+    // data access methods
+    bool contains(const KeyType& key) const noexcept { return this->read_item(key, [](const Item&) { return true; }); }
+    bool insert(const KeyType& key) noexcept         { return this->write_item(key, [](Item&) {}, key); }
+    bool erase(const KeyType& key) noexcept          { return this->erase_item(key); }
+    template <class Pred> size_t erase_if(Pred pred);
+
+    // iteration methods
+    template <class Func> void for_each(Func fn) const;
+};
+
+// delete all keys matching predicate in a single sweep
+// @pred - called as pred(const KeyType& key), key is erased if it returns true
+// returns erased keys number
+template <class KeyType, class LockPolicy>
+template <class Pred>
+size_t ConcurrentHashSet<KeyType, LockPolicy>::erase_if(Pred pred)
+{
+    return this->erase_items_if([&](const Item& item) { return pred(item._key); });
+}
+
+// visit all keys stripe by stripe, iteration is weakly consistent: every key which stays in set meanwhile is visited exactly once
+// @fn - visitor, called as fn(const KeyType& key)
+template <class KeyType, class LockPolicy>
+template <class Func>
+void ConcurrentHashSet<KeyType, LockPolicy>::for_each(Func fn) const
+{
+    this->for_each_item([&](const Item& item) { fn(item._key); });
+}
@@ -1,18 +1,48 @@
 #pragma once
+#include "ConcurrentHashCore.h"
+#include "TimingWheel.h"
+#include "FrozenHashTable.h"
+#include "MappedHashTable.h"
+#include "WriteAheadLog.h"
+
+// hashtable item
+template <class KeyType, class ValType>
+struct HashTableItem
+{
+    KeyType _key;
+    ValType _val;
+    uint64_t _expires;                                      // expiration tick, 0 if item never expires
+    uint64_t _timer;                                        // expiration tick of the item timer in timing wheel, 0 if there is none
+    HashTableItem* _next = nullptr;
+    HashTableItem(const KeyType& key, const ValType& val, const uint64_t expires) noexcept : _key(key), _val(val), _expires(expires), _timer(expires) {}
+    bool expired(const uint64_t now_tick) const noexcept { return _expires && _expires <= now_tick; }
+
+    // clock is read only if item expires at all, so lookups of items without ttl don't pay for it
+    template <class Clock> bool expired(Clock clock) const noexcept { return _expires && _expires <= clock(); }
+};
 
 // Concurrent (thread safe) hash table class
 // If item with specified key not found exception will be thrown.
-template <class KeyType, class ValType>
-class ConcurrentHashTable
+// Items might be inserted with time to live, expired items are invisible right away and freed by a timing wheel.
+// Every item has at most one timer, which is moved along when item time to live is extended or removed,
+// so refreshing hot keys doesn't grow the wheel.
+// In durable mode (open_durable) mutations are appended to a write-ahead log, which is replayed over the last checkpoint after restart.
+// LockPolicy defines how buckets are locked, either by striped mutexes (StripedLocks) or by spin locks embedded into buckets (BucketLocks).
+// MemoryPolicy defines where buckets and items are allocated, either in the default heap (HeapMemory) or NUMA aware (NumaMemory).
+template <class KeyType, class ValType, class LockPolicy = StripedLocks, class MemoryPolicy = HeapMemory>
+class ConcurrentHashTable : public ConcurrentHashCore<KeyType, HashTableItem<KeyType, ValType>, LockPolicy, MemoryPolicy>
 {
 private:
+    using Item = HashTableItem<KeyType, ValType>;
+    using Core = ConcurrentHashCore<KeyType, Item, LockPolicy, MemoryPolicy>;
+
     // hash table value class, intended to implement hash table [] operator
     // (to distinguish which action, either read or write, is performed under hashtable value)
     template <class KeyType, class ValType>
     class HashTableValue
     {
     public:
-        HashTableValue(ConcurrentHashTable<KeyType, ValType>& hash_table, const KeyType& key) : _hash_table(hash_table), _key(key) {}
+        HashTableValue(ConcurrentHashTable& hash_table, const KeyType& key) : _hash_table(hash_table), _key(key) {}
         operator ValType() const                        { return _hash_table.at(_key);                 }
         HashTableValue& operator = (const ValType& val) { _hash_table.insert(_key, val); return *this; }
         bool operator == (const ValType& val) { return _hash_table.at(_key) == val; }
@@ -23,312 +53,757 @@ private:
     };
 
 public:
-    // constructor/destructor
+    // immutable copy of hashtable items, cheap to copy and safe to share between threads
+    class Snapshot
+    {
+    public:
+        using Items = std::vector<std::pair<KeyType, ValType>>;
+        using const_iterator = typename Items::const_iterator;
+
+        Snapshot() : _items(std::make_shared<Items>()) {}
+        explicit Snapshot(std::shared_ptr<const Items> items) noexcept : _items(std::move(items)) {}
+
+        size_t size() const noexcept { return _items->size(); }
+        bool empty() const noexcept { return _items->empty(); }
+        const_iterator begin() const noexcept { return _items->begin(); }
+        const_iterator end() const noexcept { return _items->end(); }
+
+    private:
+        std::shared_ptr<const Items> _items;
+    };
+
+    // constructor
     ConcurrentHashTable(const size_t capacity = 31,
                         const float max_load_factor = 0.5,
                         const float capacity_step = 2.0,
-                        const float lock_factor = (float)std::thread::hardware_concurrency()) noexcept;
-    ~ConcurrentHashTable() noexcept;
+                        const float lock_factor = (float)std::thread::hardware_concurrency(),
+                        const MemoryPolicy& memory = MemoryPolicy()) noexcept;
 
     // data access methods
-    size_t size() const noexcept { return _size; }
-    size_t capacity() const noexcept { return _capacity; }
     bool contains(const KeyType &key) const noexcept;
     const ValType& at(const KeyType &key);
-    void insert(const KeyType& key, const ValType& val) noexcept;
-    void erase(const KeyType& key) noexcept;
-    void clear() noexcept;
+    bool find(const KeyType& key, ValType& val) const;
+    void insert(const KeyType& key, const ValType& val);
+    void insert(const KeyType& key, const ValType& val, const std::chrono::milliseconds ttl);
+    void erase(const KeyType& key);
+    template <class Pred> size_t erase_if(Pred pred);
+    void clear();
+    size_t purge_expired();
     HashTableValue<KeyType, ValType> operator [](const KeyType& key) noexcept { return HashTableValue<KeyType, ValType>(*this, key); }
 
+    // iteration methods
+    template <class Func> void for_each(Func fn) const;
+    Snapshot snapshot() const;
+    FrozenHashTable<KeyType, ValType> freeze() const;
+
+    // persistence methods
+    void save(const std::string& path) const;
+    void load(const std::string& path);
+    void save_image(const std::string& path) const;
+
+    // durability methods, only checkpoint might be called concurrently with data access
+    void open_durable(const std::string& path,
+                      const bool sync_commit = true,
+                      const std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1));
+    void checkpoint();
+    void close_durable() noexcept;
+
+    // parallel iteration methods
+    template <class Func>
+    void parallel_for_each(Func fn, const size_t threads_num = std::thread::hardware_concurrency()) const;
+    template <class MapFunc, class CombineFunc>
+    auto parallel_reduce(MapFunc map, CombineFunc combine, const size_t threads_num = std::thread::hardware_concurrency()) const
+        -> std::decay_t<std::invoke_result_t<MapFunc, const KeyType&, const ValType&>>;
+
 private:
-    struct Item
+    static constexpr uint32_t _file_magic = 0x53544843;     // saved file signature, "CHTS"
+    static constexpr uint32_t _file_version = 1;            // saved file format version
+    static constexpr uint32_t _file_end = 0xFFFFFFFF;       // length prefix marking the end of records
+    static constexpr size_t _save_buffer_size = 1 << 20;    // records are written to file by blocks of this size
+
+    // write-ahead log record operations
+    enum class LogOp : uint8_t
     {
-        KeyType _key;
-        ValType _val;
-        Item* _next = nullptr;
-        Item(const KeyType& key, const ValType& val) noexcept : _key(key), _val(val) {}
+        insert = 1,
+        erase = 2,
+        clear = 3
     };
 
-    Item** _items;                                          // hashtable items
-    size_t _size = 0;                                       // hashtable items number
-    size_t _capacity;                                       // hashtable capacity
-    float _max_load_factor;                                 // hashtable maximal load factor
-    float _capacity_step;                                   // capacity increase coefficient
-    float _lock_factor;                                     // hashtable items number to item mutexes number ratio
-    mutable std::shared_mutex _global_mutex;                // global entire hashtable level mutex
-    mutable std::deque<std::shared_mutex> _items_mutexes;   // items mutexes collection to lock hashtable on particular item level
-    bool _rehashing = false;                                // flag to indicate rehashing process
+    std::mutex _purge_mutex;                                // serializes freeing expired items
+    std::mutex _expiry_mutex;                               // protects timing wheel
+    TimingWheel<KeyType> _timing_wheel;                     // expiring items keys
+    std::unique_ptr<WriteAheadLog> _wal;                    // write-ahead log, durable mode only
+    std::string _durable_path;                              // checkpoint and log files path prefix
 
     // auxiliary methods
-    bool get_item(const KeyType& key) const noexcept;
-    bool get_item(const KeyType& key, Item**& item, std::shared_mutex*& item_mutex) const noexcept;
-    bool get_item(const KeyType& key, Item**& item, std::shared_mutex*& item_mutex, Item*& prev_item) const noexcept;
-    void try_rehash() noexcept;
-    void try_add_mutex() noexcept;
+    bool insert_item(const KeyType& key, const ValType& val, const uint64_t expires);
+    size_t purge();
+    static uint64_t now_tick() noexcept;
+
+    // durability auxiliary methods
+    static std::string log_record(const LogOp op, const KeyType* key = nullptr, const ValType* val = nullptr, const uint64_t expires = 0);
+    void replay_record(const std::string_view record);
+    void save_checkpoint();
 };
 
 // constructor
 // @capacity - initial hashtable capacity
 // @max_load_factor - maximal hashtable load factor, used to determine that rehashing is needed
 // @capacity_step - capacity step, used to increase capacity while rehashing
-template <class KeyType, class ValType>
-ConcurrentHashTable<KeyType, ValType>::ConcurrentHashTable(const size_t capacity,
-                                                           const float max_load_factor,
-                                                           const float capacity_step,
-                                                           const float lock_factor) noexcept :
-    _capacity(capacity),
-    _max_load_factor(max_load_factor),
-    _capacity_step(capacity_step),
-    _lock_factor(lock_factor)
+// @lock_factor - initial hashtable items number to item mutexes number ratio, stripes number follows contention after that
+// @memory - buckets and items allocator
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::ConcurrentHashTable(const size_t capacity,
+                                                                                     const float max_load_factor,
+                                                                                     const float capacity_step,
+                                                                                     const float lock_factor,
+                                                                                     const MemoryPolicy& memory) noexcept :
+    Core(capacity, max_load_factor, capacity_step, lock_factor, memory),
+    _timing_wheel(now_tick())
 {
-    _items = new Item*[_capacity];
-    for (size_t i = 0; i < _capacity; ++i)
-        _items[i] = nullptr;
-
-    _items_mutexes.emplace_back();
-}
-
-// destructor
-template <class KeyType, class ValType>
-ConcurrentHashTable<KeyType, ValType>::~ConcurrentHashTable() noexcept
-{
-    // free hash table items
-    for (size_t i = 0; i < _capacity; ++i)
-    {
-        if (_items[i])
-            delete _items[i];
-    }
-
-    delete[] _items;
 }
 
 // checks whether item with specified key exists
 // @key - value key
-template <class KeyType, class ValType>
-bool ConcurrentHashTable<KeyType, ValType>::contains(const KeyType &key) const noexcept
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+bool ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::contains(const KeyType &key) const noexcept
 {
-    std::shared_lock<std::shared_mutex>(_global_mutex, std::defer_lock);
-    return get_item(key);
+    return this->read_item(key, [](const Item& item) { return !item.expired(now_tick); });
 }
 
 // get item by key
 // @key - value key
-template <class KeyType, class ValType>
-const ValType& ConcurrentHashTable<KeyType, ValType>::at(const KeyType &key)
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+const ValType& ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::at(const KeyType &key)
 {
-    std::shared_lock<std::shared_mutex>(_global_mutex, std::defer_lock);
-
-    // get item related data
     // return value if found or throw an exception otherwise
-    Item** item;
-    std::shared_mutex* item_mutex;
-    if (get_item(key, item, item_mutex))
-        return (*item)->_val;
+    const ValType* val = nullptr;
+    this->read_item(key, [&](const Item& item)
+    {
+        if (!item.expired(now_tick))
+            val = &item._val;
+        return val != nullptr;
+    });
+
+    if (val)
+        return *val;
     else
         throw std::out_of_range("Key not found");
 }
 
+// get copy of item value by key
+// unlike at() value is copied under item lock, so it stays valid if the item is erased concurrently
+// @key - value key
+// @val - will contain value if found
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+bool ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::find(const KeyType& key, ValType& val) const
+{
+    return this->read_item(key, [&](const Item& item)
+    {
+        if (item.expired(now_tick))
+            return false;
+
+        val = item._val;
+        return true;
+    });
+}
+
 // insert item
-// this function might be called while rehashing (it might be detected with _rehashing flag)
-// if this is the case, we shouldn't lock resources as we are already under global lock
 // @key - key of item to be inserted
 // @val - value of item to be inserted
-template <class KeyType, class ValType>
-void ConcurrentHashTable<KeyType, ValType>::insert(const KeyType& key, const ValType& val) noexcept
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::insert(const KeyType& key, const ValType& val)
 {
-    try_rehash(); // try to rehash table
-
-    if (!_rehashing) // lock entire hashtable if this function is not caused by rehashing process
-        _global_mutex.lock();
+    insert_item(key, val, 0);
+}
 
-    // get item related data
-    Item** item;
-    std::shared_mutex* item_mutex;
-    bool item_found = get_item(key, item, item_mutex);
+// insert item which expires after specified time
+// expired item becomes invisible right away, and it is freed either by purge_expired() or by one of the next inserts with ttl,
+// which free expired items unless another thread is freeing them already
+// @key - key of item to be inserted
+// @val - value of item to be inserted
+// @ttl - item time to live
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::insert(const KeyType& key, const ValType& val, const std::chrono::milliseconds ttl)
+{
+    uint64_t now = now_tick();
+    uint64_t expires = now + std::max<int64_t>(ttl.count(), 0);
+    bool schedule = insert_item(key, val, expires);
 
-    if (!item_found)
+    bool behind;
     {
-        _size++;
-        try_add_mutex(); // items number increased, check whether we should add a new mutex
+        std::lock_guard<std::mutex> expiry_lock(_expiry_mutex);
+        if (schedule)
+            _timing_wheel.schedule(key, expires);
+        behind = _timing_wheel.current() < now;
     }
 
-    // since this moment we don't need the global lock anymore, so lock the particular item and release global lock
-    std::unique_lock<std::shared_mutex> item_lock(*item_mutex, std::defer_lock);
-
-    if (!_rehashing)
-        _global_mutex.unlock();
-
-    // update value if found or insert a new item if not found
-    if (item_found)
-        (*item)->_val = val;
-    else
-        *item = new Item(key, val);
+    // free expired items if the wheel is behind, unless another thread is freeing them already
+    std::unique_lock<std::mutex> purge_lock(_purge_mutex, std::defer_lock);
+    if (behind && purge_lock.try_lock())
+        purge();
 }
 
 // delete item
 // @key - value key
-template <class KeyType, class ValType>
-void ConcurrentHashTable<KeyType, ValType>::erase(const KeyType& key) noexcept
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::erase(const KeyType& key)
 {
-    _global_mutex.lock();
-
-    // get item related data
-    Item** item;
-    Item* prev_item;
-    std::shared_mutex* item_mutex;
-    if (!get_item(key, item, item_mutex, prev_item))
+    if (!_wal)
     {
-        _global_mutex.unlock();
+        this->erase_item(key);
         return;
     }
 
-    _size--;
+    // log record is appended under item lock, so that records of the same item are ordered as the changes
+    std::string record = log_record(LogOp::erase, &key);
+    uint64_t lsn = 0;
+    this->erase_item_if(key, [&](const Item&) { lsn = _wal->append(record); return true; });
+    if (lsn)
+        _wal->commit(lsn);
+}
 
-    // delete item from chain
-    if (prev_item)
-        prev_item->_next = (*item)->_next;
+// delete all items matching predicate in a single sweep
+// buckets are swept stripe by stripe under item write locks, so writers of other stripes are not blocked,
+// items count is adjusted once per stripe and erased items are freed after the stripe lock is released
+// @pred - called as pred(const KeyType& key, const ValType& val), item is erased if it returns true
+// returns erased items number
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+template <class Pred>
+size_t ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::erase_if(Pred pred)
+{
+    if (!_wal)
+        return this->erase_items_if([&](const Item& item) { return pred(item._key, item._val); });
+
+    uint64_t lsn = 0;
+    size_t erased_num = this->erase_items_if([&](const Item& item)
+    {
+        if (!pred(item._key, item._val))
+            return false;
 
-    // since this moment we don't need the global lock anymore, so lock the particular item (if found) and release global lock
-    std::unique_lock<std::shared_mutex> item_lock(*item_mutex, std::defer_lock);
-    _global_mutex.unlock();
+        lsn = std::max(lsn, _wal->append(log_record(LogOp::erase, &item._key)));
+        return true;
+    });
 
-    delete *item;
-    *item = nullptr;
+    if (lsn)
+        _wal->commit(lsn);
+    return erased_num;
 }
 
 // delete all items
-template <class KeyType, class ValType>
-void ConcurrentHashTable<KeyType, ValType>::clear() noexcept
+// timers are dropped while items are still locked, so that no item is left with a timer which is not in the wheel
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::clear()
+{
+    uint64_t lsn = 0;
+    this->clear_items([&]
+    {
+        if (_wal)
+            lsn = _wal->append(log_record(LogOp::clear));
+
+        std::lock_guard<std::mutex> expiry_lock(_expiry_mutex);
+        _timing_wheel.clear();
+    });
+
+    if (_wal)
+        _wal->commit(lsn);
+}
+
+// free expired items
+// waits if another thread is freeing them, and frees every item which expired before the call
+// returns freed items number
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+size_t ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::purge_expired()
 {
-    std::unique_lock<std::shared_mutex> item_lock(_global_mutex, std::defer_lock);
+    std::lock_guard<std::mutex> purge_lock(_purge_mutex);
+    return purge();
+}
 
-    for (size_t i = 0; i < _size; ++i)
+// visit all items stripe by stripe
+// iteration is weakly consistent: rehashing waits until all stripes are visited, so every item which stays in hashtable meanwhile
+// is visited exactly once, each stripe is visited under its read lock, so writers of other stripes are not blocked,
+// but changes made to already visited stripes are not seen
+// @fn - visitor, called as fn(const KeyType& key, const ValType& val)
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+template <class Func>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::for_each(Func fn) const
+{
+    uint64_t now = now_tick();
+    this->for_each_item([&](const Item& item)
     {
-        if (_items[i])
+        if (!item.expired(now))
+            fn(item._key, item._val);
+    });
+}
+
+// make copy of all items
+// items are copied into a flat array stripe by stripe, so every stripe is copied at a single point in time
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+typename ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::Snapshot ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::snapshot() const
+{
+    auto items = std::make_shared<typename Snapshot::Items>();
+    items->reserve(this->size());
+
+    uint64_t now = now_tick();
+    this->for_each_item([&](const Item& item)
+    {
+        if (!item.expired(now))
+            items->emplace_back(item._key, item._val);
+    });
+
+    return Snapshot(std::move(items));
+}
+
+// build immutable read-only copy of all items, with lock free lookups by minimal perfect hash
+// items are copied stripe by stripe, perfect hash function is built afterwards
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+FrozenHashTable<KeyType, ValType> ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::freeze() const
+{
+    typename FrozenHashTable<KeyType, ValType>::Items items;
+    items.reserve(this->size());
+
+    uint64_t now = now_tick();
+    this->for_each_item([&](const Item& item)
+    {
+        if (!item.expired(now))
+            items.emplace_back(item._key, item._val);
+    });
+
+    return FrozenHashTable<KeyType, ValType>(std::move(items));
+}
+
+// save all items to a binary file while hashtable stays online
+// items are visited stripe by stripe while rehashing waits, so every item which stays in hashtable meanwhile is saved exactly once,
+// and every stripe is saved at a single point in time.
+// File format: header (magic, version, items number hint), records (length prefix, key, value, remaining ttl in ms or 0),
+// end marker, records number and checksum of records. Keys and values are stored by Serializer.
+// @path - file path
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::save(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Failed to open file " + path);
+
+    std::string buffer;
+    Serializer<uint32_t>::write(buffer, _file_magic);
+    Serializer<uint32_t>::write(buffer, _file_version);
+    Serializer<uint64_t>::write(buffer, (uint64_t)this->size());
+
+    Checksum checksum;
+    uint64_t records_num = 0;
+    uint64_t now = now_tick();
+    std::string record;
+    this->for_each_item([&](const Item& item)
+    {
+        if (item.expired(now))
+            return;
+
+        record.clear();
+        Serializer<KeyType>::write(record, item._key);
+        Serializer<ValType>::write(record, item._val);
+        Serializer<uint64_t>::write(record, item._expires ? item._expires - now : 0);
+
+        size_t record_pos = buffer.size();
+        Serializer<uint32_t>::write(buffer, (uint32_t)record.size());
+        buffer.append(record);
+        checksum.update(buffer.data() + record_pos, buffer.size() - record_pos);
+        records_num++;
+
+        if (buffer.size() >= _save_buffer_size)
         {
-            delete _items[i];
-            _items[i] = nullptr;
+            file.write(buffer.data(), buffer.size());
+            buffer.clear();
         }
+    });
+
+    Serializer<uint32_t>::write(buffer, _file_end);
+    Serializer<uint64_t>::write(buffer, records_num);
+    Serializer<uint64_t>::write(buffer, checksum.value());
+    file.write(buffer.data(), buffer.size());
+    file.flush();
+
+    if (!file)
+        throw std::runtime_error("Failed to write file " + path);
+}
+
+// replace all items with ones saved to a binary file by save
+// hashtable is pre-sized by saved items number, so it is not rehashed while loading.
+// If file is malformed, hashtable is left empty and exception is thrown.
+// @path - file path
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Failed to open file " + path);
+
+    // read fixed size fields
+    auto read_raw = [&](auto& val)
+    {
+        char data[sizeof(val)];
+        const char* pos = data;
+        return file.read(data, sizeof(data)) && Serializer<std::decay_t<decltype(val)>>::read(pos, data + sizeof(data), val);
+    };
+
+    uint32_t magic = 0, version = 0;
+    uint64_t items_num = 0;
+    if (!read_raw(magic) || !read_raw(version) || !read_raw(items_num) || magic != _file_magic || version != _file_version)
+        throw std::runtime_error("Invalid file header " + path);
+
+    // items number is only a hint, so don't trust it beyond what the file might contain
+    std::streampos data_pos = file.tellg();
+    file.seekg(0, std::ios::end);
+    uint64_t max_items_num = (uint64_t)(file.tellg() - data_pos) / (sizeof(uint32_t) + sizeof(uint64_t));
+    file.seekg(data_pos);
+
+    clear();
+    this->reserve((size_t)std::min(items_num, max_items_num));
+
+    Checksum checksum;
+    uint64_t records_num = 0;
+    std::string record;
+    bool valid = false;
+    for (;;)
+    {
+        uint32_t len = 0;
+        if (!read_raw(len))
+            break;
+
+        if (len == _file_end)
+        {
+            uint64_t saved_records_num = 0, saved_checksum = 0;
+            valid = read_raw(saved_records_num) && read_raw(saved_checksum) &&
+                    saved_records_num == records_num && saved_checksum == checksum.value();
+            break;
+        }
+
+        record.resize(sizeof(len) + len);
+        std::memcpy(&record[0], &len, sizeof(len));
+        if (!file.read(&record[sizeof(len)], len))
+            break;
+        checksum.update(record.data(), record.size());
+
+        KeyType key;
+        ValType val;
+        uint64_t ttl = 0;
+        const char* pos = record.data() + sizeof(len);
+        const char* end = record.data() + record.size();
+        if (!Serializer<KeyType>::read(pos, end, key) || !Serializer<ValType>::read(pos, end, val) ||
+            !Serializer<uint64_t>::read(pos, end, ttl) || pos != end)
+            break;
+
+        if (ttl)
+            insert(key, val, std::chrono::milliseconds(ttl));
+        else
+            insert(key, val);
+        records_num++;
     }
 
-    _size = 0;
+    if (!valid)
+    {
+        clear();
+        throw std::runtime_error("Invalid file data " + path);
+    }
 }
 
-// get item by key
-// must be called under global lock
-// @key         searchable item key
-// @item_mutex  will contain item mutex
-template <class KeyType, class ValType>
-bool ConcurrentHashTable<KeyType, ValType>::get_item(const KeyType& key) const noexcept
+// write all items to an image file, which might be opened by MappedHashTable
+// records are written straight from a stripe by stripe walk, so items are not copied, and every stripe is saved at a single point in time
+// @path - image file path
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::save_image(const std::string& path) const
 {
-    Item** dummy1;
-    std::shared_mutex* dummy2;
-    Item* dummy3;
-    return get_item(key, dummy1, dummy2, dummy3);
+    uint64_t now = now_tick();
+    MappedHashTable<KeyType, ValType>::write_items(path, [&](auto& add)
+    {
+        this->for_each_item([&](const Item& item)
+        {
+            if (!item.expired(now))
+                add(item._key, item._val);
+        });
+    });
 }
 
-// get item by key
-// must be called under global lock
-// @key         searchable item key
-// @item        will contain item pointer reference if item found and new item pointer reference otherwise
-// @item_mutex  will contain item mutex
-template <class KeyType, class ValType>
-bool ConcurrentHashTable<KeyType, ValType>::get_item(const KeyType& key, Item**& item, std::shared_mutex*& item_mutex) const noexcept
+// switch to durable mode: restore items from the last checkpoint and write-ahead log, and log all further changes
+// Files used: <path>.checkpoint - items saved by save, <path>.wal - log of changes since the checkpoint,
+// <path>.wal.old - log being checkpointed, if a crash happened during checkpoint.
+// Restored items are checkpointed at once, so that the log starts empty and a torn log tail is dropped.
+// @path - checkpoint and log files path prefix
+// @sync_commit - whether changes wait until they are synced to disk, otherwise changes of the last flush interval might be lost
+// @flush_interval - log flush interval
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::open_durable(const std::string& path,
+                                                                                   const bool sync_commit,
+                                                                                   const std::chrono::milliseconds flush_interval)
 {
-    Item* dummy;
-    return get_item(key, item, item_mutex, dummy);
+    static_assert(is_serializable_v<KeyType> && is_serializable_v<ValType>, "Durable mode needs Serializer for key and value types");
+
+    close_durable();
+    _durable_path = path;
+
+    if (std::filesystem::exists(path + ".checkpoint"))
+        load(path + ".checkpoint");
+    else
+        clear();
+
+    // logs are merged from threads buffers, so records are replayed in LSN order
+    std::vector<std::pair<uint64_t, std::string>> records;
+    auto collect = [&](uint64_t lsn, std::string_view record) { records.emplace_back(lsn, std::string(record)); };
+    WriteAheadLog::replay(path + ".wal.old", collect);
+    WriteAheadLog::replay(path + ".wal", collect);
+    std::sort(records.begin(), records.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    for (const auto& record : records)
+        replay_record(record.second);
+
+    save_checkpoint();
+    std::filesystem::remove(path + ".wal.old");
+    std::filesystem::remove(path + ".wal");
+
+    uint64_t next_lsn = records.empty() ? 1 : records.back().first + 1;
+    _wal = std::make_unique<WriteAheadLog>(path + ".wal", next_lsn, sync_commit, flush_interval);
 }
 
-// get item by key
-// must be called under global lock
-// @key         searchable item key
-// @item        will contain item pointer reference if item found and new item pointer reference otherwise
-// @item_mutex  will contain item mutex
-// @prev_item   will contain previous item reference
-template <class KeyType, class ValType>
-bool ConcurrentHashTable<KeyType, ValType>::get_item(const KeyType &key,
-                                                     Item**& item,
-                                                     std::shared_mutex*& item_mutex,
-                                                     Item*& prev_item) const noexcept
+// save all items to checkpoint file and drop the log of changes made before
+// log is rotated before items are saved, so every change which is missed by save of an already visited stripe is in the new log,
+// and rehashing waits while items are saved, so items which don't change are not missed by moving between stripes
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::checkpoint()
 {
-    bool res = false;
-    prev_item = nullptr;
+    if (!_wal)
+        throw std::logic_error("Hashtable is not durable");
 
-    std::hash<KeyType> hash_func;
-    size_t item_idx = hash_func(key) % _capacity;
+    _wal->rotate(_durable_path + ".wal.old");
+    save_checkpoint();
+    std::filesystem::remove(_durable_path + ".wal.old");
+}
 
-    item = &_items[item_idx];
+// leave durable mode, all logged changes are synced
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::close_durable() noexcept
+{
+    _wal.reset();
+}
 
-    // find item with given key
-    for (Item* i = *item; i; i = i->_next)
+// visit all items in parallel
+// buckets range is split into chunks which are distributed between threads by work stealing,
+// rehashing waits until all items are visited, so every item which stays in hashtable meanwhile is visited exactly once
+// @fn - visitor, called concurrently as fn(const KeyType& key, const ValType& val)
+// @threads_num - threads number, including calling thread
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+template <class Func>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::parallel_for_each(Func fn, const size_t threads_num) const
+{
+    uint64_t now = now_tick();
+    this->parallel_for_each_item(threads_num, [&](size_t, const Item& item)
     {
-        if (i->_key == key)
+        if (!item.expired(now))
+            fn(item._key, item._val);
+    });
+}
+
+// map all items and combine the results in parallel
+// every thread combines its own items, and per thread results are combined at the end,
+// so combine must be associative, its order of arguments is not specified
+// @map - called concurrently as map(const KeyType& key, const ValType& val)
+// @combine - called as combine(result, result)
+// @threads_num - threads number, including calling thread
+// returns value initialized result if hashtable is empty
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+template <class MapFunc, class CombineFunc>
+auto ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::parallel_reduce(MapFunc map, CombineFunc combine, const size_t threads_num) const
+    -> std::decay_t<std::invoke_result_t<MapFunc, const KeyType&, const ValType&>>
+{
+    using Result = std::decay_t<std::invoke_result_t<MapFunc, const KeyType&, const ValType&>>;
+
+    uint64_t now = now_tick();
+    std::vector<std::optional<Result>> results(threads_num ? threads_num : 1);
+
+    this->parallel_for_each_item(results.size(), [&](size_t worker_idx, const Item& item)
+    {
+        if (item.expired(now))
+            return;
+
+        std::optional<Result>& res = results[worker_idx];
+        if (res)
+            res = combine(std::move(*res), map(item._key, item._val));
+        else
+            res = map(item._key, item._val);
+    });
+
+    // combine per thread results
+    std::optional<Result> total;
+    for (auto& res : results)
+    {
+        if (!res)
+            continue;
+        if (total)
+            total = combine(std::move(*total), std::move(*res));
+        else
+            total = std::move(res);
+    }
+
+    return total ? std::move(*total) : Result();
+}
+
+// insert item
+// item keeps its timer if it fires not later than the new expiration, as the timer is moved to the expiration when it fires
+// @key - key of item to be inserted
+// @val - value of item to be inserted
+// @expires - expiration tick, 0 if item never expires
+// returns true if a new timer must be scheduled at the expiration tick
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+bool ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::insert_item(const KeyType& key, const ValType& val, const uint64_t expires)
+{
+    bool schedule = false;
+    auto update = [&](Item& item)
+    {
+        item._val = val;
+        item._expires = expires;
+
+        // previous timer, if any, becomes stale
+        if (expires && (!item._timer || item._timer > expires))
         {
-            res = true;
-            break;
+            item._timer = expires;
+            schedule = true;
         }
+    };
 
-        item = &i->_next;
-        prev_item = i;
+    // update value if found or insert a new item if not found
+    bool inserted;
+    if (!_wal)
+        inserted = this->write_item(key, update, key, val, expires);
+    else
+    {
+        // log record is appended under item lock, so that records of the same item are ordered as the changes
+        std::string record = log_record(LogOp::insert, &key, &val, expires);
+        uint64_t lsn = 0;
+        inserted = this->write_item_notify(key, update, [&](Item&) { lsn = _wal->append(record); }, key, val, expires);
+        _wal->commit(lsn);
     }
 
-    // set item mutex regardless of whether we found an item or not
-    size_t lock_idx = item_idx % _items_mutexes.size();
-    item_mutex = &_items_mutexes[lock_idx];
-
-    return res;
+    return schedule || (inserted && expires);
 }
 
-// rehash if load factor is exceeded
-template <class KeyType, class ValType>
-void ConcurrentHashTable<KeyType, ValType>::try_rehash() noexcept
+// free expired items, must be called under purge mutex
+// timing wheel is advanced up to now and items of due timers are erased in a batch, so that every stripe is locked once,
+// timer of an item which expiration was extended or removed since the timer was scheduled is moved to the new expiration
+// returns freed items number
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+size_t ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::purge()
 {
-    if (_rehashing)
-        return;
+    uint64_t now = now_tick();
+    std::vector<std::pair<KeyType, uint64_t>> due;
+    {
+        std::lock_guard<std::mutex> expiry_lock(_expiry_mutex);
+        _timing_wheel.advance(now, [&](const KeyType& key, uint64_t expires) { due.emplace_back(key, expires); });
+    }
 
-    std::unique_lock<std::shared_mutex> global_lock(_global_mutex, std::defer_lock);
+    std::vector<std::pair<KeyType, uint64_t>> moved;
+    size_t freed_num = this->erase_items_batch(due, [&](Item& item, const uint64_t timer)
+    {
+        // timer is stale if the item was re-inserted or got an earlier timer since then
+        if (item._timer != timer)
+            return false;
 
-    // check load factor
-    if ((float)_size / (float)_capacity <= _max_load_factor)
-        return;
+        if (item.expired(now))
+            return true;
 
-    _rehashing = true;
+        item._timer = item._expires;
+        if (item._timer)
+            moved.emplace_back(item._key, item._timer);
+        return false;
+    });
 
-    // save old capacity and data
-    size_t old_capacity = _capacity;
-    Item** old_items = _items;
+    if (!moved.empty())
+    {
+        std::lock_guard<std::mutex> expiry_lock(_expiry_mutex);
+        for (const auto& timer : moved)
+            _timing_wheel.schedule(timer.first, timer.second);
+    }
 
-    // clear size, increase capacity and allocate a new hash table
-    _size = 0;
-    _capacity = std::lroundf(_capacity * _capacity_step);
-    _items = new Item*[_capacity];
-    for (size_t i = 0; i < _capacity; ++i)
-        _items[i] = nullptr;
+    return freed_num;
+}
 
-    // copy elements with freeing old items
-    for (size_t i = 0; i < old_capacity; ++i)
+// make write-ahead log record
+// record format: operation, key and value (stored by Serializer), expiration time since epoch in ms or 0
+// @op - operation
+// @key - item key, insert and erase only
+// @val - item value, insert only
+// @expires - expiration tick, insert only
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+std::string ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::log_record(const LogOp op, const KeyType* key, const ValType* val, const uint64_t expires)
+{
+    // hashtables of types without Serializer can't be durable, so their records are never made
+    std::string record;
+    if constexpr (is_serializable_v<KeyType> && is_serializable_v<ValType>)
     {
-        Item* old_item = old_items[i];
-        while (old_item)
+        Serializer<uint8_t>::write(record, (uint8_t)op);
+        if (key)
+            Serializer<KeyType>::write(record, *key);
+
+        if (val)
         {
-            insert(old_item->_key, old_item->_val);
-            Item* next_item = old_item->_next;
-            delete old_item;
-            old_item = next_item;
+            Serializer<ValType>::write(record, *val);
+
+            // ticks don't survive restart, so store system clock time
+            int64_t expires_ms = 0;
+            if (expires)
+            {
+                auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+                expires_ms = std::max<int64_t>(now_ms + ((int64_t)expires - (int64_t)now_tick()), 1);
+            }
+            Serializer<int64_t>::write(record, expires_ms);
         }
     }
 
-    // free old items
-    delete[] old_items;
+    return record;
+}
+
+// apply write-ahead log record
+// @record - record made by log_record
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::replay_record(const std::string_view record)
+{
+    const char* pos = record.data();
+    const char* end = record.data() + record.size();
+
+    uint8_t op = 0;
+    KeyType key;
+    ValType val;
+    int64_t expires_ms = 0;
+    if (!Serializer<uint8_t>::read(pos, end, op))
+        throw std::runtime_error("Invalid log record");
+
+    if ((LogOp)op == LogOp::clear)
+        clear();
+    else if ((LogOp)op == LogOp::erase && Serializer<KeyType>::read(pos, end, key))
+        erase(key);
+    else if ((LogOp)op == LogOp::insert && Serializer<KeyType>::read(pos, end, key) &&
+             Serializer<ValType>::read(pos, end, val) && Serializer<int64_t>::read(pos, end, expires_ms))
+    {
+        auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        if (expires_ms)
+            insert(key, val, std::chrono::milliseconds(expires_ms - now_ms));
+        else
+            insert(key, val);
+    }
+    else
+        throw std::runtime_error("Invalid log record");
+}
 
-    _rehashing = false;
+// save all items to checkpoint file, which is replaced only after it is completely written and synced
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+void ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::save_checkpoint()
+{
+    save(_durable_path + ".checkpoint.tmp");
+    WriteAheadLog::sync_file(_durable_path + ".checkpoint.tmp");
+    std::filesystem::rename(_durable_path + ".checkpoint.tmp", _durable_path + ".checkpoint");
 }
 
-// add mutex if there are not enough mutexes
-// must be called under global lock
-template <class KeyType, class ValType>
-void ConcurrentHashTable<KeyType, ValType>::try_add_mutex() noexcept
+// get current tick of items expiration, tick is one millisecond
+template <class KeyType, class ValType, class LockPolicy, class MemoryPolicy>
+uint64_t ConcurrentHashTable<KeyType, ValType, LockPolicy, MemoryPolicy>::now_tick() noexcept
 {
-    if ((float)_size / _lock_factor >= _items_mutexes.size())
-        _items_mutexes.emplace_back();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
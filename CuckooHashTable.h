@@ -0,0 +1,675 @@
+#pragma once
+#include "Hash.h"
+#include "StripedCounter.h"
+#include "Locks.h"
+
+// Concurrent (thread safe) bucketized cuckoo hash table class
+// Every bucket holds up to SlotsNum items with one byte partial keys, and every key might be placed in one of two buckets only,
+// so a lookup touches two buckets at most and compares full keys only if partial keys match.
+// If both buckets are full, insert searches for a short path of items to move to their alternative buckets (breadth first, as libcuckoo does),
+// and table grows only if there is no such path, so it works at load factors above 90%.
+// Buckets are protected by a fixed number of striped spin locks: lookups and updates lock two buckets, every move of the path
+// locks two buckets of the moved item, and the path is searched without holding locks and validated while it is executed.
+// Partial keys of buckets are kept in an array of their own, 8 or 16 bytes per bucket, and items in another array, so a lookup
+// reads two small blocks of partial keys and touches items only if partial keys match, whatever the items size is.
+// If item with specified key not found exception will be thrown.
+template <class KeyType, class ValType, size_t SlotsNum = 4>
+class CuckooHashTable
+{
+    static_assert(SlotsNum >= 4 && SlotsNum <= 8, "Slots number must be in [4, 8]");
+
+public:
+    // constructor/destructor
+    explicit CuckooHashTable(const size_t capacity = 64, const size_t locks_num = 1024, const size_t max_path_nodes = 512);
+    ~CuckooHashTable() noexcept;
+
+    // data access methods
+    size_t size() const noexcept { return _size.approximate(); }
+    size_t size_exact() const noexcept { return _size.exact(); }
+    size_t capacity() const noexcept { return (_mask.load(std::memory_order_relaxed) + 1) * SlotsNum; }
+    bool contains(const KeyType& key) const;
+    ValType at(const KeyType& key) const;
+    bool find(const KeyType& key, ValType& val) const;
+    void insert(const KeyType& key, const ValType& val);
+    bool erase(const KeyType& key);
+    void clear() noexcept;
+
+    // iteration methods
+    template <class Func> void for_each(Func fn) const;
+
+private:
+    struct Entry
+    {
+        KeyType _key;
+        ValType _val;
+    };
+
+    // bucket partial keys, aligned so that they never straddle cache lines
+    struct alignas(SlotsNum < 8 ? 8 : 16) Bucket
+    {
+        uint8_t _partials[SlotsNum];                        // partial keys of occupied slots
+        uint8_t _occupied = 0;                              // occupied slots bitmask
+
+        bool occupied(const size_t slot) const noexcept { return (_occupied >> slot) & 1; }
+        int free_slot() const noexcept;
+    };
+
+    // bucket items
+    struct Slots
+    {
+        alignas(Entry) unsigned char _entries[SlotsNum][sizeof(Entry)];
+
+        Entry& entry(const size_t slot) noexcept { return *reinterpret_cast<Entry*>(_entries[slot]); }
+        const Entry& entry(const size_t slot) const noexcept { return *reinterpret_cast<const Entry*>(_entries[slot]); }
+    };
+
+    // stripe lock, padded to a cache line to avoid false sharing
+    struct alignas(64) Lock
+    {
+        mutable SpinLock _lock;
+    };
+
+    // key hash split into the first bucket index and partial key
+    struct Hash
+    {
+        size_t _hash;
+        uint8_t _partial;
+    };
+
+    // node of cuckoo path search, parent item in slot moves to the node bucket
+    struct PathNode
+    {
+        size_t _bucket;
+        size_t _parent;
+        size_t _slot;
+    };
+
+    // two locked buckets of a key
+    struct LockedPair
+    {
+        const CuckooHashTable* _table;
+        size_t _first;                                      // first bucket index
+        size_t _second;                                     // second bucket index
+        size_t _mask;                                       // buckets number - 1, when buckets were locked
+
+        ~LockedPair() noexcept { _table->unlock_pair(_first, _second); }
+    };
+
+    std::atomic<Bucket*> _buckets;                          // buckets partial keys array
+    std::atomic<Slots*> _slots;                             // buckets items array
+    std::atomic<size_t> _mask;                              // buckets number - 1, buckets number is a power of 2
+    std::unique_ptr<Lock[]> _locks;                         // buckets stripes locks
+    size_t _locks_num;                                      // locks number, a power of 2
+    size_t _max_path_nodes;                                 // buckets visited by cuckoo path search before table grows
+    StripedCounter _size;                                   // items number
+
+    // auxiliary methods
+    static Hash hash(const KeyType& key) noexcept;
+    static size_t alt_bucket(const size_t bucket, const uint8_t partial, const size_t mask) noexcept;
+    size_t lock_idx(const size_t bucket) const noexcept { return bucket & (_locks_num - 1); }
+    void lock_pair(const size_t first, const size_t second) const noexcept;
+    void unlock_pair(const size_t first, const size_t second) const noexcept;
+    LockedPair lock_key(const Hash& h) const noexcept;
+    template <class Func> bool visit_item(const KeyType& key, Func fn) const;
+    bool cuckoo(const size_t first, const size_t second, const size_t mask);
+    bool find_path(const Bucket* buckets, const size_t mask, const size_t first, const size_t second,
+                   std::vector<PathNode>& nodes, size_t& found) const;
+    static void move_entry(Bucket* buckets, Slots* slots, const size_t from, const size_t from_slot, const size_t to, const size_t to_slot);
+    bool place_entry(Bucket* buckets, Slots* slots, const size_t mask, Entry&& entry) const;
+    void grow(const size_t mask);
+    void set_size_batch(const size_t buckets_num) noexcept;
+    void lock_all() const noexcept;
+    void unlock_all() const noexcept;
+    static void destroy_entries(Bucket* buckets, Slots* slots, const size_t buckets_num) noexcept;
+};
+
+// find free slot of bucket
+// returns -1 if bucket is full
+template <class KeyType, class ValType, size_t SlotsNum>
+int CuckooHashTable<KeyType, ValType, SlotsNum>::Bucket::free_slot() const noexcept
+{
+    for (size_t slot = 0; slot < SlotsNum; ++slot)
+    {
+        if (!occupied(slot))
+            return (int)slot;
+    }
+    return -1;
+}
+
+// constructor
+// @capacity - initial items capacity
+// @locks_num - buckets stripes locks number, rounded up to a power of 2
+// @max_path_nodes - buckets visited by cuckoo path search before table grows
+template <class KeyType, class ValType, size_t SlotsNum>
+CuckooHashTable<KeyType, ValType, SlotsNum>::CuckooHashTable(const size_t capacity, const size_t locks_num, const size_t max_path_nodes) :
+    _max_path_nodes(std::max<size_t>(max_path_nodes, 2))
+{
+    size_t buckets_num = 2;
+    while (buckets_num * SlotsNum < capacity)
+        buckets_num *= 2;
+
+    _locks_num = 1;
+    while (_locks_num < locks_num)
+        _locks_num *= 2;
+
+    _buckets = new Bucket[buckets_num];
+    _slots = new Slots[buckets_num];
+    _mask = buckets_num - 1;
+    _locks.reset(new Lock[_locks_num]);
+    set_size_batch(buckets_num);
+}
+
+// destructor
+template <class KeyType, class ValType, size_t SlotsNum>
+CuckooHashTable<KeyType, ValType, SlotsNum>::~CuckooHashTable() noexcept
+{
+    destroy_entries(_buckets, _slots, _mask + 1);
+    delete[] _buckets.load();
+    delete[] _slots.load();
+}
+
+// checks whether item with specified key exists
+// @key - value key
+template <class KeyType, class ValType, size_t SlotsNum>
+bool CuckooHashTable<KeyType, ValType, SlotsNum>::contains(const KeyType& key) const
+{
+    return visit_item(key, [](const Entry&) {});
+}
+
+// get copy of item value by key, items move between buckets, so no reference is returned
+// @key - value key
+template <class KeyType, class ValType, size_t SlotsNum>
+ValType CuckooHashTable<KeyType, ValType, SlotsNum>::at(const KeyType& key) const
+{
+    ValType val;
+    if (!find(key, val))
+        throw std::out_of_range("Key not found");
+    return val;
+}
+
+// get copy of item value by key
+// @key - value key
+// @val - will contain value if found
+template <class KeyType, class ValType, size_t SlotsNum>
+bool CuckooHashTable<KeyType, ValType, SlotsNum>::find(const KeyType& key, ValType& val) const
+{
+    return visit_item(key, [&](const Entry& entry) { val = entry._val; });
+}
+
+// insert item or update it if it exists
+// @key - key of item to be inserted
+// @val - value of item to be inserted
+template <class KeyType, class ValType, size_t SlotsNum>
+void CuckooHashTable<KeyType, ValType, SlotsNum>::insert(const KeyType& key, const ValType& val)
+{
+    Hash h = hash(key);
+    for (;;)
+    {
+        size_t first, second, mask;
+        {
+            LockedPair pair = lock_key(h);
+            Bucket* buckets = _buckets.load(std::memory_order_relaxed);
+            Slots* slots = _slots.load(std::memory_order_relaxed);
+
+            // update item if found
+            for (size_t bucket_idx : { pair._first, pair._second })
+            {
+                Bucket& bucket = buckets[bucket_idx];
+                for (size_t slot = 0; slot < SlotsNum; ++slot)
+                {
+                    if (bucket.occupied(slot) && bucket._partials[slot] == h._partial && slots[bucket_idx].entry(slot)._key == key)
+                    {
+                        slots[bucket_idx].entry(slot)._val = val;
+                        return;
+                    }
+                }
+            }
+
+            // insert item into a free slot of either bucket
+            for (size_t bucket_idx : { pair._first, pair._second })
+            {
+                Bucket& bucket = buckets[bucket_idx];
+                int slot = bucket.free_slot();
+                if (slot >= 0)
+                {
+                    new (slots[bucket_idx]._entries[slot]) Entry{ key, val };
+                    bucket._partials[slot] = h._partial;
+                    bucket._occupied |= (uint8_t)(1u << slot);
+                    _size.add(1);
+                    return;
+                }
+            }
+
+            first = pair._first;
+            second = pair._second;
+            mask = pair._mask;
+        }
+
+        // both buckets are full, so free a slot by moving items along a cuckoo path, or grow the table if there is no path
+        if (!cuckoo(first, second, mask))
+            grow(mask);
+    }
+}
+
+// delete item
+// @key - value key
+// returns true if item was deleted
+template <class KeyType, class ValType, size_t SlotsNum>
+bool CuckooHashTable<KeyType, ValType, SlotsNum>::erase(const KeyType& key)
+{
+    Hash h = hash(key);
+    LockedPair pair = lock_key(h);
+    Bucket* buckets = _buckets.load(std::memory_order_relaxed);
+    Slots* slots = _slots.load(std::memory_order_relaxed);
+
+    for (size_t bucket_idx : { pair._first, pair._second })
+    {
+        Bucket& bucket = buckets[bucket_idx];
+        for (size_t slot = 0; slot < SlotsNum; ++slot)
+        {
+            if (bucket.occupied(slot) && bucket._partials[slot] == h._partial && slots[bucket_idx].entry(slot)._key == key)
+            {
+                slots[bucket_idx].entry(slot).~Entry();
+                bucket._occupied &= (uint8_t)~(1u << slot);
+                _size.add(-1);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// delete all items
+template <class KeyType, class ValType, size_t SlotsNum>
+void CuckooHashTable<KeyType, ValType, SlotsNum>::clear() noexcept
+{
+    lock_all();
+    destroy_entries(_buckets, _slots, _mask + 1);
+    _size.reset();
+    unlock_all();
+}
+
+// visit all items while the whole table is locked
+// @fn - visitor, called as fn(const KeyType& key, const ValType& val)
+template <class KeyType, class ValType, size_t SlotsNum>
+template <class Func>
+void CuckooHashTable<KeyType, ValType, SlotsNum>::for_each(Func fn) const
+{
+    lock_all();
+    try
+    {
+        const Bucket* buckets = _buckets.load(std::memory_order_relaxed);
+        const Slots* slots = _slots.load(std::memory_order_relaxed);
+        for (size_t i = 0; i <= _mask.load(std::memory_order_relaxed); ++i)
+        {
+            for (size_t slot = 0; slot < SlotsNum; ++slot)
+            {
+                if (buckets[i].occupied(slot))
+                    fn(slots[i].entry(slot)._key, slots[i].entry(slot)._val);
+            }
+        }
+    }
+    catch (...)
+    {
+        unlock_all();
+        throw;
+    }
+    unlock_all();
+}
+
+// hash key
+// @key - key
+template <class KeyType, class ValType, size_t SlotsNum>
+typename CuckooHashTable<KeyType, ValType, SlotsNum>::Hash CuckooHashTable<KeyType, ValType, SlotsNum>::hash(const KeyType& key) noexcept
+{
+    uint64_t h = mix_hash(std::hash<KeyType>()(key));
+    return Hash{ (size_t)h, (uint8_t)(h >> 56) };
+}
+
+// get alternative bucket of item, it depends on partial key only, so items might be moved without their keys rehashing
+// alternative bucket of alternative bucket is the original one
+// @bucket - item bucket
+// @partial - item partial key
+// @mask - buckets number - 1
+template <class KeyType, class ValType, size_t SlotsNum>
+size_t CuckooHashTable<KeyType, ValType, SlotsNum>::alt_bucket(const size_t bucket, const uint8_t partial, const size_t mask) noexcept
+{
+    return (bucket ^ (size_t)((partial + 1) * 0xC6A4A7935BD1E995ull)) & mask;
+}
+
+// lock two buckets in locks order, so that threads locking the same pair don't deadlock
+// @first - first bucket index
+// @second - second bucket index
+template <class KeyType, class ValType, size_t SlotsNum>
+void CuckooHashTable<KeyType, ValType, SlotsNum>::lock_pair(const size_t first, const size_t second) const noexcept
+{
+    size_t first_lock = lock_idx(first), second_lock = lock_idx(second);
+    _locks[std::min(first_lock, second_lock)]._lock.lock();
+    if (first_lock != second_lock)
+        _locks[std::max(first_lock, second_lock)]._lock.lock();
+}
+
+// unlock two buckets
+// @first - first bucket index
+// @second - second bucket index
+template <class KeyType, class ValType, size_t SlotsNum>
+void CuckooHashTable<KeyType, ValType, SlotsNum>::unlock_pair(const size_t first, const size_t second) const noexcept
+{
+    size_t first_lock = lock_idx(first), second_lock = lock_idx(second);
+    _locks[first_lock]._lock.unlock();
+    if (first_lock != second_lock)
+        _locks[second_lock]._lock.unlock();
+}
+
+// lock both buckets of key
+// table might grow while locks are being taken, so buckets are locked again if it did
+// @h - key hash
+template <class KeyType, class ValType, size_t SlotsNum>
+typename CuckooHashTable<KeyType, ValType, SlotsNum>::LockedPair CuckooHashTable<KeyType, ValType, SlotsNum>::lock_key(const Hash& h) const noexcept
+{
+    for (;;)
+    {
+        size_t mask = _mask.load(std::memory_order_acquire);
+        size_t first = h._hash & mask;
+        size_t second = alt_bucket(first, h._partial, mask);
+        lock_pair(first, second);
+
+        // growing takes all locks, so mask can't change while the pair is locked
+        if (_mask.load(std::memory_order_relaxed) == mask)
+            return LockedPair{ this, first, second, mask };
+
+        unlock_pair(first, second);
+    }
+}
+
+// find item and call a function for it under buckets locks
+// @key - item key
+// @fn - called as fn(const Entry& entry) if item is found
+// returns true if item is found
+template <class KeyType, class ValType, size_t SlotsNum>
+template <class Func>
+bool CuckooHashTable<KeyType, ValType, SlotsNum>::visit_item(const KeyType& key, Func fn) const
+{
+    Hash h = hash(key);
+    LockedPair pair = lock_key(h);
+    const Bucket* buckets = _buckets.load(std::memory_order_relaxed);
+    const Slots* slots = _slots.load(std::memory_order_relaxed);
+
+    for (size_t bucket_idx : { pair._first, pair._second })
+    {
+        const Bucket& bucket = buckets[bucket_idx];
+        for (size_t slot = 0; slot < SlotsNum; ++slot)
+        {
+            if (bucket.occupied(slot) && bucket._partials[slot] == h._partial && slots[bucket_idx].entry(slot)._key == key)
+            {
+                fn(slots[bucket_idx].entry(slot));
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// free a slot in one of two buckets by moving items along a cuckoo path
+// path is searched bucket by bucket, so it might become invalid before it is executed,
+// then every move is validated and the caller retries if any of them fails
+// @first - first bucket index
+// @second - second bucket index
+// @mask - buckets number - 1, when buckets were found full
+// returns false if there is no path, so table should grow
+template <class KeyType, class ValType, size_t SlotsNum>
+bool CuckooHashTable<KeyType, ValType, SlotsNum>::cuckoo(const size_t first, const size_t second, const size_t mask)
+{
+    std::vector<PathNode> nodes;
+    size_t found = 0;
+    if (!find_path(nullptr, mask, first, second, nodes, found))
+        return _mask.load(std::memory_order_relaxed) != mask; // table has grown meanwhile, so the caller should just retry
+
+    // move items starting from the path end, so that every move has a free slot to go to
+    for (size_t node = found; nodes[node]._parent != (size_t)-1; node = nodes[node]._parent)
+    {
+        const PathNode& to = nodes[node];
+        const PathNode& from = nodes[to._parent];
+
+        lock_pair(from._bucket, to._bucket);
+        bool moved = false;
+        if (_mask.load(std::memory_order_relaxed) == mask)
+        {
+            Bucket* buckets = _buckets.load(std::memory_order_relaxed);
+            Bucket& from_bucket = buckets[from._bucket];
+            int to_slot = buckets[to._bucket].free_slot();
+
+            // item might have been moved or erased since the path was found
+            if (to_slot >= 0 && from_bucket.occupied(to._slot) &&
+                alt_bucket(from._bucket, from_bucket._partials[to._slot], mask) == to._bucket)
+            {
+                move_entry(buckets, _slots.load(std::memory_order_relaxed), from._bucket, to._slot, to._bucket, (size_t)to_slot);
+                moved = true;
+            }
+        }
+        unlock_pair(from._bucket, to._bucket);
+
+        if (!moved)
+            return true;
+    }
+
+    return true;
+}
+
+// search for a cuckoo path breadth first, the path ends with a bucket which has a free slot
+// @buckets - buckets array if the whole table is locked, otherwise nullptr and every bucket is read under its lock
+// @mask - buckets number - 1
+// @first - first bucket index
+// @second - second bucket index
+// @nodes - will contain search tree
+// @found - will contain index of the path end node
+// returns false if there is no path
+template <class KeyType, class ValType, size_t SlotsNum>
+bool CuckooHashTable<KeyType, ValType, SlotsNum>::find_path(const Bucket* buckets, const size_t mask, const size_t first, const size_t second,
+                                                            std::vector<PathNode>& nodes, size_t& found) const
+{
+    nodes.clear();
+    nodes.push_back(PathNode{ first, (size_t)-1, 0 });
+    if (second != first)
+        nodes.push_back(PathNode{ second, (size_t)-1, 0 });
+
+    for (size_t node = 0; node < nodes.size(); ++node)
+    {
+        uint8_t occupied = 0;
+        uint8_t partials[SlotsNum];
+        size_t bucket_idx = nodes[node]._bucket;
+
+        if (buckets)
+        {
+            occupied = buckets[bucket_idx]._occupied;
+            std::memcpy(partials, buckets[bucket_idx]._partials, SlotsNum);
+        }
+        else
+        {
+            std::lock_guard<SpinLock> lock(_locks[lock_idx(bucket_idx)]._lock);
+            if (_mask.load(std::memory_order_relaxed) != mask)
+                return false;
+
+            const Bucket& bucket = _buckets.load(std::memory_order_relaxed)[bucket_idx];
+            occupied = bucket._occupied;
+            std::memcpy(partials, bucket._partials, SlotsNum);
+        }
+
+        // the first buckets are known to be full, their free slots mean that an item was erased meanwhile
+        if (occupied != (uint8_t)((1u << SlotsNum) - 1))
+        {
+            found = node;
+            return true;
+        }
+
+        for (size_t slot = 0; slot < SlotsNum && nodes.size() < _max_path_nodes; ++slot)
+            nodes.push_back(PathNode{ alt_bucket(bucket_idx, partials[slot], mask), node, slot });
+    }
+
+    return false;
+}
+
+// move item between buckets
+// @buckets - buckets partial keys array
+// @slots - buckets items array
+// @from - source bucket index
+// @from_slot - source slot
+// @to - destination bucket index
+// @to_slot - destination free slot
+template <class KeyType, class ValType, size_t SlotsNum>
+void CuckooHashTable<KeyType, ValType, SlotsNum>::move_entry(Bucket* buckets, Slots* slots, const size_t from, const size_t from_slot,
+                                                             const size_t to, const size_t to_slot)
+{
+    new (slots[to]._entries[to_slot]) Entry(std::move(slots[from].entry(from_slot)));
+    buckets[to]._partials[to_slot] = buckets[from]._partials[from_slot];
+    buckets[to]._occupied |= (uint8_t)(1u << to_slot);
+
+    slots[from].entry(from_slot).~Entry();
+    buckets[from]._occupied &= (uint8_t)~(1u << from_slot);
+}
+
+// place item into a table which is not accessed concurrently
+// @buckets - buckets partial keys array
+// @slots - buckets items array
+// @mask - buckets number - 1
+// @entry - item
+// returns false if there is no free slot for item
+template <class KeyType, class ValType, size_t SlotsNum>
+bool CuckooHashTable<KeyType, ValType, SlotsNum>::place_entry(Bucket* buckets, Slots* slots, const size_t mask, Entry&& entry) const
+{
+    Hash h = hash(entry._key);
+    size_t first = h._hash & mask;
+    size_t second = alt_bucket(first, h._partial, mask);
+
+    std::vector<PathNode> nodes;
+    size_t found = 0;
+    if (!find_path(buckets, mask, first, second, nodes, found))
+        return false;
+
+    size_t node = found;
+    for (; nodes[node]._parent != (size_t)-1; node = nodes[node]._parent)
+    {
+        const PathNode& to = nodes[node];
+        move_entry(buckets, slots, nodes[to._parent]._bucket, to._slot, to._bucket, (size_t)buckets[to._bucket].free_slot());
+    }
+
+    Bucket& bucket = buckets[nodes[node]._bucket];
+    int slot = bucket.free_slot();
+    new (slots[nodes[node]._bucket]._entries[slot]) Entry(std::move(entry));
+    bucket._partials[slot] = h._partial;
+    bucket._occupied |= (uint8_t)(1u << slot);
+    return true;
+}
+
+// double buckets number, all locks are taken meanwhile
+// @mask - buckets number - 1, when there was no cuckoo path, table is not grown if it has grown since then
+template <class KeyType, class ValType, size_t SlotsNum>
+void CuckooHashTable<KeyType, ValType, SlotsNum>::grow(const size_t mask)
+{
+    lock_all();
+    if (_mask.load(std::memory_order_relaxed) != mask)
+    {
+        unlock_all();
+        return;
+    }
+
+    Bucket* old_buckets = _buckets.load(std::memory_order_relaxed);
+    Slots* old_slots = _slots.load(std::memory_order_relaxed);
+    size_t old_buckets_num = mask + 1;
+
+    // move items to a bigger table, and grow again in the unlikely case some item can't be placed
+    size_t new_buckets_num = old_buckets_num * 2;
+    Bucket* new_buckets = new Bucket[new_buckets_num];
+    Slots* new_slots = new Slots[new_buckets_num];
+    std::vector<Entry> entries;
+    entries.reserve(_size.exact());
+    for (size_t i = 0; i < old_buckets_num; ++i)
+    {
+        for (size_t slot = 0; slot < SlotsNum; ++slot)
+        {
+            if (old_buckets[i].occupied(slot))
+                entries.push_back(std::move(old_slots[i].entry(slot)));
+        }
+    }
+    destroy_entries(old_buckets, old_slots, old_buckets_num);
+
+    for (;;)
+    {
+        size_t placed = 0;
+        while (placed < entries.size() && place_entry(new_buckets, new_slots, new_buckets_num - 1, std::move(entries[placed])))
+            placed++;
+
+        if (placed == entries.size())
+            break;
+
+        // take placed items back after the ones not placed yet and try a bigger table
+        for (size_t i = 0; i < new_buckets_num; ++i)
+        {
+            for (size_t slot = 0; slot < SlotsNum; ++slot)
+            {
+                if (new_buckets[i].occupied(slot))
+                    entries.push_back(std::move(new_slots[i].entry(slot)));
+            }
+        }
+        entries.erase(entries.begin(), entries.begin() + placed);
+        destroy_entries(new_buckets, new_slots, new_buckets_num);
+        delete[] new_buckets;
+        delete[] new_slots;
+        new_buckets_num *= 2;
+        new_buckets = new Bucket[new_buckets_num];
+        new_slots = new Slots[new_buckets_num];
+    }
+
+    _buckets.store(new_buckets, std::memory_order_relaxed);
+    _slots.store(new_slots, std::memory_order_relaxed);
+    _mask.store(new_buckets_num - 1, std::memory_order_release);
+    set_size_batch(new_buckets_num);
+    delete[] old_buckets;
+    delete[] old_slots;
+    unlock_all();
+}
+
+// set size counter batch according to capacity, so that counter cells don't update the shared total on every insert or erase
+// and the approximate size error stays within a small fraction of capacity
+// @buckets_num - buckets number
+template <class KeyType, class ValType, size_t SlotsNum>
+void CuckooHashTable<KeyType, ValType, SlotsNum>::set_size_batch(const size_t buckets_num) noexcept
+{
+    _size.set_batch(buckets_num * SlotsNum / (8 * _size.cells_num()));
+}
+
+// lock all buckets in locks order
+template <class KeyType, class ValType, size_t SlotsNum>
+void CuckooHashTable<KeyType, ValType, SlotsNum>::lock_all() const noexcept
+{
+    for (size_t i = 0; i < _locks_num; ++i)
+        _locks[i]._lock.lock();
+}
+
+// unlock all buckets
+template <class KeyType, class ValType, size_t SlotsNum>
+void CuckooHashTable<KeyType, ValType, SlotsNum>::unlock_all() const noexcept
+{
+    for (size_t i = 0; i < _locks_num; ++i)
+        _locks[i]._lock.unlock();
+}
+
+// destroy all items of buckets arrays
+// @buckets - buckets partial keys array
+// @slots - buckets items array
+// @buckets_num - buckets number
+template <class KeyType, class ValType, size_t SlotsNum>
+void CuckooHashTable<KeyType, ValType, SlotsNum>::destroy_entries(Bucket* buckets, Slots* slots, const size_t buckets_num) noexcept
+{
+    for (size_t i = 0; i < buckets_num; ++i)
+    {
+        for (size_t slot = 0; slot < SlotsNum; ++slot)
+        {
+            if (buckets[i].occupied(slot))
+                slots[i].entry(slot).~Entry();
+        }
+        buckets[i]._occupied = 0;
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+// Count-min sketch of 4-bit counters, used to estimate how often a key was accessed
+// Sixteen counters are packed into a 64-bit word and every key is counted in four counters of different rows.
+// Once the number of increments reaches the sample size all counters are halved, so that old popularity fades out.
+class FrequencySketch
+{
+public:
+    explicit FrequencySketch(const size_t capacity);
+
+    void increment(const size_t hash) noexcept;
+    uint8_t frequency(const size_t hash) const noexcept;
+    void clear() noexcept;
+
+private:
+    static const size_t _depth = 4;                         // counters number per key
+    static const uint8_t _max_count = 15;                   // maximal 4-bit counter value
+
+    std::vector<uint64_t> _table;                           // packed counters
+    size_t _counters_mask;                                  // counters number - 1, counters number is a power of 2
+    size_t _sample_size;                                    // increments number after which counters are halved
+    size_t _additions = 0;                                  // increments number since the last halving
+
+    size_t counter_idx(const size_t hash, const size_t row) const noexcept;
+    void reset() noexcept;
+};
+
+// constructor
+// @capacity - number of keys to estimate frequencies of, usually cache capacity
+inline FrequencySketch::FrequencySketch(const size_t capacity)
+{
+    // 16 counters per expected key, rounded up to a power of 2
+    size_t words_num = 1;
+    while (words_num < capacity)
+        words_num <<= 1;
+
+    _table.assign(words_num, 0);
+    _counters_mask = words_num * 16 - 1;
+    _sample_size = 10 * (capacity ? capacity : 1);
+}
+
+// count key access
+// @hash - key hash
+inline void FrequencySketch::increment(const size_t hash) noexcept
+{
+    bool added = false;
+    for (size_t row = 0; row < _depth; ++row)
+    {
+        size_t idx = counter_idx(hash, row);
+        uint64_t& word = _table[idx / 16];
+        size_t shift = (idx % 16) * 4;
+        if (((word >> shift) & 0xF) < _max_count)
+        {
+            word += (uint64_t)1 << shift;
+            added = true;
+        }
+    }
+
+    if (added && ++_additions >= _sample_size)
+        reset();
+}
+
+// estimate key accesses number, it is the minimal value of the key counters
+// @hash - key hash
+inline uint8_t FrequencySketch::frequency(const size_t hash) const noexcept
+{
+    uint8_t res = _max_count;
+    for (size_t row = 0; row < _depth; ++row)
+    {
+        size_t idx = counter_idx(hash, row);
+        res = std::min(res, (uint8_t)((_table[idx / 16] >> ((idx % 16) * 4)) & 0xF));
+    }
+    return res;
+}
+
+// zero all counters
+inline void FrequencySketch::clear() noexcept
+{
+    std::fill(_table.begin(), _table.end(), 0);
+    _additions = 0;
+}
+
+// get counter index of a key in a row
+// key hash is remixed with a different seed for every row, so that rows are independent
+// @hash - key hash
+// @row - row number
+inline size_t FrequencySketch::counter_idx(const size_t hash, const size_t row) const noexcept
+{
+    static const uint64_t seeds[_depth] = { 0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0xD6E8FEB86659FD93ull };
+
+    uint64_t h = ((uint64_t)hash + seeds[row]) * seeds[(row + 1) % _depth];
+    h ^= h >> 32;
+    return (size_t)h & _counters_mask;
+}
+
+// halve all counters
+inline void FrequencySketch::reset() noexcept
+{
+    for (uint64_t& word : _table)
+        word = (word >> 1) & 0x7777777777777777ull;
+    _additions /= 2;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "PerfectHash.h"
+
+// Immutable hash table built with a minimal perfect hash function
+// Items are placed into a flat array at positions given by the perfect hash function, with no gaps.
+// Lookup reads the bucket pilot and the item at the computed position, so it takes two cache misses for most keys
+// (three for a few percent of keys, whose positions are remapped)
+// and no synchronization, as the table never changes after it is built.
+// If item with specified key not found exception will be thrown.
+template <class KeyType, class ValType>
+class FrozenHashTable
+{
+public:
+    using Items = std::vector<std::pair<KeyType, ValType>>;
+
+    FrozenHashTable() = default;
+    explicit FrozenHashTable(Items items);
+
+    // data access methods
+    size_t size() const noexcept { return _items.size(); }
+    bool contains(const KeyType& key) const noexcept { return find_item(key) != nullptr; }
+    const ValType& at(const KeyType& key) const;
+    bool find(const KeyType& key, ValType& val) const;
+
+    // iteration methods
+    template <class Func> void for_each(Func fn) const;
+
+private:
+    Items _items;                                           // items placed at their perfect hash positions
+    PerfectHash _hash;                                      // keys perfect hash function
+
+    const std::pair<KeyType, ValType>* find_item(const KeyType& key) const noexcept;
+};
+
+// constructor
+// @items - items with unique keys
+template <class KeyType, class ValType>
+FrozenHashTable<KeyType, ValType>::FrozenHashTable(Items items)
+{
+    std::vector<uint64_t> hashes(items.size());
+    for (size_t i = 0; i < items.size(); ++i)
+        hashes[i] = std::hash<KeyType>()(items[i].first);
+
+    if (!_hash.build(hashes))
+        throw std::invalid_argument("Perfect hash function not found, keys are probably not unique");
+
+    // move items to their places
+    _items.resize(items.size());
+    for (size_t i = 0; i < items.size(); ++i)
+        _items[_hash.position(hashes[i])] = std::move(items[i]);
+}
+
+// get item by key
+// @key - value key
+template <class KeyType, class ValType>
+const ValType& FrozenHashTable<KeyType, ValType>::at(const KeyType& key) const
+{
+    const std::pair<KeyType, ValType>* item = find_item(key);
+    if (item)
+        return item->second;
+    else
+        throw std::out_of_range("Key not found");
+}
+
+// get copy of item value by key
+// @key - value key
+// @val - will contain value if found
+template <class KeyType, class ValType>
+bool FrozenHashTable<KeyType, ValType>::find(const KeyType& key, ValType& val) const
+{
+    const std::pair<KeyType, ValType>* item = find_item(key);
+    if (item)
+        val = item->second;
+    return item != nullptr;
+}
+
+// visit all items
+// @fn - visitor, called as fn(const KeyType& key, const ValType& val)
+template <class KeyType, class ValType>
+template <class Func>
+void FrozenHashTable<KeyType, ValType>::for_each(Func fn) const
+{
+    for (const auto& item : _items)
+        fn(item.first, item.second);
+}
+
+// find item by key
+// @key - item key
+// returns nullptr if not found
+template <class KeyType, class ValType>
+const std::pair<KeyType, ValType>* FrozenHashTable<KeyType, ValType>::find_item(const KeyType& key) const noexcept
+{
+    if (_items.empty())
+        return nullptr;
+
+    const std::pair<KeyType, ValType>& item = _items[_hash.position(std::hash<KeyType>()(key))];
+    return item.first == key ? &item : nullptr;
+}
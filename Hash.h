@@ -0,0 +1,21 @@
+#pragma once
+
+// mix bits of a hash, so that its every bit depends on every input bit (splitmix64 finalizer)
+constexpr uint64_t mix_hash(uint64_t h) noexcept
+{
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    h ^= h >> 31;
+    return h;
+}
+
+// hash of raw bytes, stable between processes and platforms (64-bit FNV-1a with mixed bits)
+constexpr uint64_t hash_bytes(const std::string_view bytes) noexcept
+{
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (char c : bytes)
+        h = (h ^ (uint8_t)c) * 0x100000001B3ull;
+    return mix_hash(h);
+}
@@ -0,0 +1,473 @@
+#pragma once
+#include "Hash.h"
+#include "StripedCounter.h"
+#include "Locks.h"
+
+// Concurrent (thread safe) hopscotch hash table class
+// Every item lives within _hop_range slots of its home bucket, and every bucket has a bitmap of neighborhood slots holding its items,
+// so a lookup reads a bounded and cache resident range of slots. Insert takes the closest free slot and, if it is out of the neighborhood,
+// moves it closer by swapping it with items whose own neighborhoods cover it, table grows only if there is no such item.
+// Buckets are split into contiguous segments with a spin lock each. An operation locks segments of the key neighborhood, insert also locks
+// segments it probes for a free slot. Segments are always locked in ascending order, so writers to different segments run in parallel.
+// If item with specified key not found exception will be thrown.
+template <class KeyType, class ValType>
+class HopscotchHashTable
+{
+public:
+    // constructor/destructor
+    explicit HopscotchHashTable(const size_t capacity = 64, const size_t segments_num = 1024);
+    ~HopscotchHashTable() noexcept;
+
+    // data access methods
+    size_t size() const noexcept { return _size.approximate(); }
+    size_t size_exact() const noexcept { return _size.exact(); }
+    size_t capacity() const noexcept { return _mask.load(std::memory_order_relaxed) + 1; }
+    bool contains(const KeyType& key) const;
+    ValType at(const KeyType& key) const;
+    bool find(const KeyType& key, ValType& val) const;
+    void insert(const KeyType& key, const ValType& val);
+    bool erase(const KeyType& key);
+    void clear() noexcept;
+
+    // iteration methods
+    template <class Func> void for_each(Func fn) const;
+
+private:
+    static constexpr size_t _hop_range = 32;                // neighborhood size, items live within it from their home buckets
+    static constexpr size_t _max_probe = 1024;              // slots probed for a free one before table grows
+
+    struct Entry
+    {
+        KeyType _key;
+        ValType _val;
+    };
+
+    struct Bucket
+    {
+        uint32_t _hop_info = 0;                             // neighborhood slots holding items of this bucket
+        bool _occupied = false;                             // whether slot holds an item
+        alignas(Entry) unsigned char _entry[sizeof(Entry)];
+
+        Entry& entry() noexcept { return *reinterpret_cast<Entry*>(_entry); }
+        const Entry& entry() const noexcept { return *reinterpret_cast<const Entry*>(_entry); }
+    };
+
+    // segment lock, padded to a cache line to avoid false sharing
+    struct alignas(64) Lock
+    {
+        mutable SpinLock _lock;
+    };
+
+    // locked segments range
+    struct LockedRange
+    {
+        const HopscotchHashTable* _table;
+        size_t _first;                                      // first locked segment
+        size_t _last;                                       // last locked segment
+        size_t _mask;                                       // buckets number - 1, when segments were locked
+
+        ~LockedRange() noexcept { _table->unlock_segments(_first, _last); }
+        void extend(const size_t slot) noexcept;
+    };
+
+    std::atomic<Bucket*> _buckets;                          // buckets array, followed by _hop_range - 1 overflow slots
+    std::atomic<size_t> _mask;                              // buckets number - 1, buckets number is a power of 2
+    std::atomic<size_t> _segment_shift{0};                  // log2 of segment size
+    std::unique_ptr<Lock[]> _locks;                         // segments locks
+    size_t _segments_num;                                   // segments number
+    StripedCounter _size;                                   // items number
+
+    // auxiliary methods
+    static size_t hash(const KeyType& key) noexcept { return (size_t)mix_hash(std::hash<KeyType>()(key)); }
+    size_t segment(const size_t slot) const noexcept { return std::min(slot >> _segment_shift.load(std::memory_order_relaxed), _segments_num - 1); }
+    void set_segment_shift(const size_t buckets_num) noexcept;
+    void set_size_batch(const size_t buckets_num) noexcept;
+    void lock_segments(const size_t first, const size_t last) const noexcept;
+    void unlock_segments(const size_t first, const size_t last) const noexcept;
+    LockedRange lock_key(const size_t h) const noexcept;
+    static size_t find_slot(const Bucket* buckets, const size_t home, const KeyType& key) noexcept;
+    template <class LockFunc> static bool add_entry(Bucket* buckets, const size_t mask, const size_t home, Entry&& entry, LockFunc lock_slot);
+    void grow(const size_t mask);
+    void lock_all() const noexcept { lock_segments(0, _segments_num - 1); }
+    void unlock_all() const noexcept { unlock_segments(0, _segments_num - 1); }
+    static void destroy_entries(Bucket* buckets, const size_t slots_num) noexcept;
+};
+
+// lock segments up to the one of specified slot
+// @slot - slot index
+template <class KeyType, class ValType>
+void HopscotchHashTable<KeyType, ValType>::LockedRange::extend(const size_t slot) noexcept
+{
+    for (size_t last = _table->segment(slot); _last < last; )
+        _table->_locks[++_last]._lock.lock();
+}
+
+// constructor
+// @capacity - initial items capacity
+// @segments_num - segments number, every segment has its own lock
+template <class KeyType, class ValType>
+HopscotchHashTable<KeyType, ValType>::HopscotchHashTable(const size_t capacity, const size_t segments_num) :
+    _segments_num(segments_num ? segments_num : 1)
+{
+    size_t buckets_num = _hop_range;
+    while (buckets_num < capacity)
+        buckets_num *= 2;
+
+    _buckets = new Bucket[buckets_num + _hop_range - 1];
+    _mask = buckets_num - 1;
+    _locks.reset(new Lock[_segments_num]);
+    set_segment_shift(buckets_num);
+    set_size_batch(buckets_num);
+}
+
+// destructor
+template <class KeyType, class ValType>
+HopscotchHashTable<KeyType, ValType>::~HopscotchHashTable() noexcept
+{
+    destroy_entries(_buckets, _mask + _hop_range);
+    delete[] _buckets.load();
+}
+
+// checks whether item with specified key exists
+// @key - value key
+template <class KeyType, class ValType>
+bool HopscotchHashTable<KeyType, ValType>::contains(const KeyType& key) const
+{
+    size_t h = hash(key);
+    LockedRange range = lock_key(h);
+    return find_slot(_buckets.load(std::memory_order_relaxed), h & range._mask, key) != (size_t)-1;
+}
+
+// get copy of item value by key, items move within neighborhoods, so no reference is returned
+// @key - value key
+template <class KeyType, class ValType>
+ValType HopscotchHashTable<KeyType, ValType>::at(const KeyType& key) const
+{
+    ValType val;
+    if (!find(key, val))
+        throw std::out_of_range("Key not found");
+    return val;
+}
+
+// get copy of item value by key
+// @key - value key
+// @val - will contain value if found
+template <class KeyType, class ValType>
+bool HopscotchHashTable<KeyType, ValType>::find(const KeyType& key, ValType& val) const
+{
+    size_t h = hash(key);
+    LockedRange range = lock_key(h);
+    const Bucket* buckets = _buckets.load(std::memory_order_relaxed);
+
+    size_t slot = find_slot(buckets, h & range._mask, key);
+    if (slot == (size_t)-1)
+        return false;
+
+    val = buckets[slot].entry()._val;
+    return true;
+}
+
+// insert item or update it if it exists
+// @key - key of item to be inserted
+// @val - value of item to be inserted
+template <class KeyType, class ValType>
+void HopscotchHashTable<KeyType, ValType>::insert(const KeyType& key, const ValType& val)
+{
+    size_t h = hash(key);
+    for (;;)
+    {
+        size_t mask;
+        {
+            LockedRange range = lock_key(h);
+            Bucket* buckets = _buckets.load(std::memory_order_relaxed);
+            size_t home = h & range._mask;
+
+            size_t slot = find_slot(buckets, home, key);
+            if (slot != (size_t)-1)
+            {
+                buckets[slot].entry()._val = val;
+                return;
+            }
+
+            if (add_entry(buckets, range._mask, home, Entry{ key, val }, [&range](const size_t slot) { range.extend(slot); }))
+            {
+                _size.add(1);
+                return;
+            }
+
+            mask = range._mask;
+        }
+
+        // there is no free slot which can be moved into the neighborhood
+        grow(mask);
+    }
+}
+
+// delete item
+// @key - value key
+// returns true if item was deleted
+template <class KeyType, class ValType>
+bool HopscotchHashTable<KeyType, ValType>::erase(const KeyType& key)
+{
+    size_t h = hash(key);
+    LockedRange range = lock_key(h);
+    Bucket* buckets = _buckets.load(std::memory_order_relaxed);
+    size_t home = h & range._mask;
+
+    size_t slot = find_slot(buckets, home, key);
+    if (slot == (size_t)-1)
+        return false;
+
+    buckets[slot].entry().~Entry();
+    buckets[slot]._occupied = false;
+    buckets[home]._hop_info &= ~(1u << (slot - home));
+    _size.add(-1);
+    return true;
+}
+
+// delete all items
+template <class KeyType, class ValType>
+void HopscotchHashTable<KeyType, ValType>::clear() noexcept
+{
+    lock_all();
+    destroy_entries(_buckets, _mask + _hop_range);
+    _size.reset();
+    unlock_all();
+}
+
+// visit all items while the whole table is locked
+// @fn - visitor, called as fn(const KeyType& key, const ValType& val)
+template <class KeyType, class ValType>
+template <class Func>
+void HopscotchHashTable<KeyType, ValType>::for_each(Func fn) const
+{
+    lock_all();
+    try
+    {
+        const Bucket* buckets = _buckets.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < _mask.load(std::memory_order_relaxed) + _hop_range; ++i)
+        {
+            if (buckets[i]._occupied)
+                fn(buckets[i].entry()._key, buckets[i].entry()._val);
+        }
+    }
+    catch (...)
+    {
+        unlock_all();
+        throw;
+    }
+    unlock_all();
+}
+
+// set segment size for buckets number, segments are at least as big as neighborhood, so a neighborhood spans two segments at most
+// @buckets_num - buckets number
+template <class KeyType, class ValType>
+void HopscotchHashTable<KeyType, ValType>::set_segment_shift(const size_t buckets_num) noexcept
+{
+    size_t shift = 0;
+    while (((size_t)1 << shift) < _hop_range || (buckets_num >> shift) > _segments_num)
+        shift++;
+    _segment_shift.store(shift, std::memory_order_relaxed);
+}
+
+// set size counter batch for buckets number, a bigger table tolerates a bigger approximate size error
+// @buckets_num - buckets number
+template <class KeyType, class ValType>
+void HopscotchHashTable<KeyType, ValType>::set_size_batch(const size_t buckets_num) noexcept
+{
+    _size.set_batch(buckets_num / (8 * _size.cells_num()));
+}
+
+// lock segments range in ascending order
+// @first - first segment
+// @last - last segment
+template <class KeyType, class ValType>
+void HopscotchHashTable<KeyType, ValType>::lock_segments(const size_t first, const size_t last) const noexcept
+{
+    for (size_t i = first; i <= last; ++i)
+        _locks[i]._lock.lock();
+}
+
+// unlock segments range
+// @first - first segment
+// @last - last segment
+template <class KeyType, class ValType>
+void HopscotchHashTable<KeyType, ValType>::unlock_segments(const size_t first, const size_t last) const noexcept
+{
+    for (size_t i = first; i <= last; ++i)
+        _locks[i]._lock.unlock();
+}
+
+// lock segments of key neighborhood
+// table might grow while locks are being taken, so segments are locked again if it did
+// @h - key hash
+template <class KeyType, class ValType>
+typename HopscotchHashTable<KeyType, ValType>::LockedRange HopscotchHashTable<KeyType, ValType>::lock_key(const size_t h) const noexcept
+{
+    for (;;)
+    {
+        size_t mask = _mask.load(std::memory_order_acquire);
+        size_t home = h & mask;
+        size_t first = segment(home), last = segment(home + _hop_range - 1);
+        lock_segments(first, last);
+
+        // growing takes all locks, so mask and segment size can't change while segments are locked
+        if (_mask.load(std::memory_order_relaxed) == mask)
+            return LockedRange{ this, first, last, mask };
+
+        unlock_segments(first, last);
+    }
+}
+
+// find slot of item in its home bucket neighborhood
+// @buckets - buckets array
+// @home - home bucket index
+// @key - item key
+// returns -1 if item not found
+template <class KeyType, class ValType>
+size_t HopscotchHashTable<KeyType, ValType>::find_slot(const Bucket* buckets, const size_t home, const KeyType& key) noexcept
+{
+    for (uint32_t hop_info = buckets[home]._hop_info; hop_info; )
+    {
+        size_t offset = 0;
+        while (!((hop_info >> offset) & 1))
+            offset++;
+
+        if (buckets[home + offset].entry()._key == key)
+            return home + offset;
+
+        hop_info &= ~(1u << offset);
+    }
+    return (size_t)-1;
+}
+
+// add item which is known to be absent, closest free slot is moved into the item neighborhood by hopping items towards it
+// @buckets - buckets array
+// @mask - buckets number - 1
+// @home - item home bucket index
+// @entry - item, it is left intact if it can't be added
+// @lock_slot - called before every slot after the home neighborhood is probed, to lock its segment
+// returns false if there is no free slot, which can be moved into the neighborhood
+template <class KeyType, class ValType>
+template <class LockFunc>
+bool HopscotchHashTable<KeyType, ValType>::add_entry(Bucket* buckets, const size_t mask, const size_t home, Entry&& entry, LockFunc lock_slot)
+{
+    // items never live farther than neighborhood of the last bucket
+    size_t last_slot = std::min(home + _max_probe, mask + _hop_range - 1);
+    size_t free_slot = home;
+    for (; free_slot <= last_slot; ++free_slot)
+    {
+        if (free_slot >= home + _hop_range)
+            lock_slot(free_slot);
+        if (!buckets[free_slot]._occupied)
+            break;
+    }
+    if (free_slot > last_slot)
+        return false;
+
+    while (free_slot - home >= _hop_range)
+    {
+        // find the closest to home item, which might move to the free slot without leaving its neighborhood
+        size_t moved_slot = (size_t)-1;
+        for (size_t bucket = free_slot - _hop_range + 1; bucket < free_slot && moved_slot == (size_t)-1; ++bucket)
+        {
+            for (size_t offset = 0; bucket + offset < free_slot; ++offset)
+            {
+                if ((buckets[bucket]._hop_info >> offset) & 1)
+                {
+                    moved_slot = bucket + offset;
+                    new (buckets[free_slot]._entry) Entry(std::move(buckets[moved_slot].entry()));
+                    buckets[free_slot]._occupied = true;
+                    buckets[moved_slot].entry().~Entry();
+                    buckets[moved_slot]._occupied = false;
+                    buckets[bucket]._hop_info = (buckets[bucket]._hop_info & ~(1u << offset)) | (1u << (free_slot - bucket));
+                    break;
+                }
+            }
+        }
+
+        if (moved_slot == (size_t)-1)
+            return false;
+        free_slot = moved_slot;
+    }
+
+    new (buckets[free_slot]._entry) Entry(std::move(entry));
+    buckets[free_slot]._occupied = true;
+    buckets[home]._hop_info |= 1u << (free_slot - home);
+    return true;
+}
+
+// double buckets number, all locks are taken meanwhile
+// @mask - buckets number - 1, when there was no free slot, table is not grown if it has grown since then
+template <class KeyType, class ValType>
+void HopscotchHashTable<KeyType, ValType>::grow(const size_t mask)
+{
+    lock_all();
+    if (_mask.load(std::memory_order_relaxed) != mask)
+    {
+        unlock_all();
+        return;
+    }
+
+    Bucket* old_buckets = _buckets.load(std::memory_order_relaxed);
+    size_t old_slots_num = mask + _hop_range;
+
+    // move items to a bigger table, and grow again in the unlikely case some item can't be added
+    size_t new_buckets_num = (mask + 1) * 2;
+    Bucket* new_buckets = new Bucket[new_buckets_num + _hop_range - 1];
+    std::vector<Entry> entries;
+    entries.reserve(_size.exact());
+    for (size_t i = 0; i < old_slots_num; ++i)
+    {
+        if (old_buckets[i]._occupied)
+            entries.push_back(std::move(old_buckets[i].entry()));
+    }
+    destroy_entries(old_buckets, old_slots_num);
+
+    for (;;)
+    {
+        size_t placed = 0;
+        while (placed < entries.size() &&
+               add_entry(new_buckets, new_buckets_num - 1, hash(entries[placed]._key) & (new_buckets_num - 1), std::move(entries[placed]), [](const size_t) {}))
+            placed++;
+
+        if (placed == entries.size())
+            break;
+
+        // take added items back and try a bigger table
+        for (size_t i = 0; i < new_buckets_num + _hop_range - 1; ++i)
+        {
+            if (new_buckets[i]._occupied)
+                entries.push_back(std::move(new_buckets[i].entry()));
+        }
+        entries.erase(entries.begin(), entries.begin() + placed);
+        destroy_entries(new_buckets, new_buckets_num + _hop_range - 1);
+        delete[] new_buckets;
+        new_buckets_num *= 2;
+        new_buckets = new Bucket[new_buckets_num + _hop_range - 1];
+    }
+
+    _buckets.store(new_buckets, std::memory_order_relaxed);
+    set_segment_shift(new_buckets_num);
+    set_size_batch(new_buckets_num);
+    _mask.store(new_buckets_num - 1, std::memory_order_release);
+    delete[] old_buckets;
+    unlock_all();
+}
+
+// destroy all items of buckets array
+// @buckets - buckets array
+// @slots_num - slots number
+template <class KeyType, class ValType>
+void HopscotchHashTable<KeyType, ValType>::destroy_entries(Bucket* buckets, const size_t slots_num) noexcept
+{
+    for (size_t i = 0; i < slots_num; ++i)
+    {
+        if (buckets[i]._occupied)
+        {
+            buckets[i].entry().~Entry();
+            buckets[i]._occupied = false;
+        }
+        buckets[i]._hop_info = 0;
+    }
+}
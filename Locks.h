@@ -0,0 +1,307 @@
+#pragma once
+#include "StripedCounter.h"
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// hint processor that the calling thread is spinning
+inline void cpu_relax() noexcept
+{
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+    _mm_pause();
+#elif defined(__i386__) || defined(__x86_64__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Test-and-test-and-set spin lock
+// It is one byte in size, so it can be embedded right into the data it protects.
+// Shared locking is exclusive, as critical sections the lock is intended for are too short to benefit from shared access.
+class SpinLock
+{
+public:
+    void lock() noexcept
+    {
+        // try to acquire the lock, and spin on reading (not writing) the lock word while it is taken
+        while (_locked.exchange(1, std::memory_order_acquire))
+        {
+            while (_locked.load(std::memory_order_relaxed))
+                cpu_relax();
+        }
+    }
+
+    bool try_lock() noexcept         { return !_locked.load(std::memory_order_relaxed) && !_locked.exchange(1, std::memory_order_acquire); }
+    void unlock() noexcept           { _locked.store(0, std::memory_order_release); }
+    void lock_shared() noexcept      { lock();       }
+    bool try_lock_shared() noexcept  { return try_lock(); }
+    void unlock_shared() noexcept    { unlock();     }
+
+private:
+    std::atomic<uint8_t> _locked{0};
+};
+
+// block calling thread while word equals specified value, it might also wake up spuriously
+// @word - word to wait on
+// @val - word value to wait while
+inline void park(std::atomic<uint32_t>& word, uint32_t val) noexcept
+{
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "atomic word can't be waited on");
+#if defined(_WIN32)
+    WaitOnAddress(&word, &val, sizeof(val), INFINITE);
+#elif defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, val, nullptr, nullptr, 0);
+#else
+    (void)word;
+    (void)val;
+    std::this_thread::yield();
+#endif
+}
+
+// wake one thread parked on word
+// @word - word threads wait on
+inline void unpark_one(std::atomic<uint32_t>& word) noexcept
+{
+#if defined(_WIN32)
+    WakeByAddressSingle(&word);
+#elif defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+// Spin-then-park lock
+// Contended lock spins with exponential backoff first, as critical sections are usually much shorter than a kernel wake up,
+// and parks the thread on futex (WaitOnAddress on Windows) only if the owner holds the lock longer than that.
+// Spin budget follows recent contended acquisitions: it grows towards twice the spins which succeeded and decays when spinning fails,
+// so the lock stops burning cycles on long critical sections. It is 8 bytes in size, and shared locking is exclusive, as for SpinLock.
+class AdaptiveMutex
+{
+public:
+    void lock() noexcept
+    {
+        uint32_t state = 0;
+        if (!_state.compare_exchange_strong(state, 1, std::memory_order_acquire, std::memory_order_relaxed))
+            lock_contended();
+    }
+
+    bool try_lock() noexcept
+    {
+        uint32_t state = 0;
+        return !_state.load(std::memory_order_relaxed) &&
+               _state.compare_exchange_strong(state, 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock() noexcept
+    {
+        if (_state.exchange(0, std::memory_order_release) == 2)
+            unpark_one(_state);
+    }
+
+    void lock_shared() noexcept      { lock();       }
+    bool try_lock_shared() noexcept  { return try_lock(); }
+    void unlock_shared() noexcept    { unlock();     }
+
+private:
+    static constexpr uint32_t _min_spins = 16;              // spin budget when spinning never succeeds
+    static constexpr uint32_t _max_spins = 1 << 14;         // spin budget limit, pauses number
+    static constexpr uint32_t _max_backoff = 64;            // pauses between attempts limit
+
+    std::atomic<uint32_t> _state{0};                        // 0 - unlocked, 1 - locked, 2 - locked and there might be parked threads
+    std::atomic<uint32_t> _spins{0};                        // average spins successful contended acquisitions took recently
+
+    void lock_contended() noexcept
+    {
+        // spin with exponential backoff while it is likely that the owner releases the lock soon
+        uint32_t spins_limit = std::min(_spins.load(std::memory_order_relaxed) * 2 + _min_spins, _max_spins);
+        uint32_t spins = 0;
+        for (uint32_t backoff = 1; spins < spins_limit; backoff = std::min(backoff * 2, _max_backoff))
+        {
+            for (uint32_t i = 0; i < backoff; ++i)
+                cpu_relax();
+            spins += backoff;
+
+            if (try_lock())
+            {
+                adapt(spins);
+                return;
+            }
+        }
+        adapt(0);
+
+        // park, marking the lock as having parked threads, so that the owner wakes one of them up
+        while (_state.exchange(2, std::memory_order_acquire))
+            park(_state, 2);
+    }
+
+    // move average spins an eighth of the way towards the last contended acquisition
+    void adapt(const uint32_t spins) noexcept
+    {
+        int64_t avg = _spins.load(std::memory_order_relaxed);
+        _spins.store((uint32_t)(avg + ((int64_t)spins - avg) / 8), std::memory_order_relaxed);
+    }
+};
+
+// Ticket spin lock
+// Threads take the lock in the order they came, so no thread starves under contention, unlike with SpinLock.
+// Shared locking is exclusive, as for SpinLock.
+class TicketLock
+{
+public:
+    void lock() noexcept
+    {
+        uint32_t ticket = _next.fetch_add(1, std::memory_order_relaxed);
+        while (_serving.load(std::memory_order_acquire) != ticket)
+            cpu_relax();
+    }
+
+    bool try_lock() noexcept
+    {
+        uint32_t ticket = _serving.load(std::memory_order_relaxed);
+        uint32_t next = ticket;
+        return _next.compare_exchange_strong(next, ticket + 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock() noexcept           { _serving.store(_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+    void lock_shared() noexcept      { lock();       }
+    bool try_lock_shared() noexcept  { return try_lock(); }
+    void unlock_shared() noexcept    { unlock();     }
+
+private:
+    std::atomic<uint32_t> _next{0};                         // next ticket to be handed out
+    std::atomic<uint32_t> _serving{0};                      // ticket of the lock owner
+};
+
+// Reader-writer lock with a distributed reader indicator (BRAVO-like)
+// Every reader increments one of several counters picked by its thread index, so readers running on different cores
+// don't contend on a single cache line, as they do on std::shared_mutex reader counter.
+// Writer takes the writer flag and waits until all counters drop to zero, so writes are slower and the lock suits read-mostly data.
+class DistributedRWLock
+{
+public:
+    void lock() noexcept
+    {
+        while (_writer.exchange(true, std::memory_order_seq_cst))
+            wait([this]() { return !_writer.load(std::memory_order_relaxed); });
+
+        for (auto& readers : _readers)
+            wait([&readers]() { return readers._count.load(std::memory_order_seq_cst) == 0; });
+    }
+
+    bool try_lock() noexcept
+    {
+        if (_writer.load(std::memory_order_relaxed) || _writer.exchange(true, std::memory_order_seq_cst))
+            return false;
+
+        for (auto& readers : _readers)
+        {
+            if (readers._count.load(std::memory_order_seq_cst))
+            {
+                _writer.store(false, std::memory_order_release);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void unlock() noexcept           { _writer.store(false, std::memory_order_release); }
+
+    void lock_shared() noexcept
+    {
+        // announce the reader first and back off if a writer came meanwhile, writer sees the announcement otherwise
+        Readers& readers = _readers[thread_index() % _readers_num];
+        for (;;)
+        {
+            readers._count.fetch_add(1, std::memory_order_seq_cst);
+            if (!_writer.load(std::memory_order_seq_cst))
+                return;
+
+            readers._count.fetch_sub(1, std::memory_order_release);
+            wait([this]() { return !_writer.load(std::memory_order_relaxed); });
+        }
+    }
+
+    bool try_lock_shared() noexcept
+    {
+        Readers& readers = _readers[thread_index() % _readers_num];
+        readers._count.fetch_add(1, std::memory_order_seq_cst);
+        if (!_writer.load(std::memory_order_seq_cst))
+            return true;
+
+        readers._count.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+    void unlock_shared() noexcept    { _readers[thread_index() % _readers_num]._count.fetch_sub(1, std::memory_order_release); }
+
+private:
+    static constexpr size_t _readers_num = 8;               // reader counters number
+    static constexpr size_t _spins_num = 64;                // spins before yielding the processor while waiting
+
+    // reader counter, padded to a cache line to avoid false sharing
+    struct alignas(64) Readers
+    {
+        std::atomic<size_t> _count{0};
+    };
+
+    Readers _readers[_readers_num];                         // readers counters
+    alignas(64) std::atomic<bool> _writer{false};           // writer flag, set while writer holds or waits for the lock
+
+    // spin and then yield until condition is met, as writer might hold the lock for a while (rehashing)
+    template <class Cond>
+    static void wait(Cond cond) noexcept
+    {
+        for (size_t spins = 0; !cond(); ++spins)
+        {
+            if (spins < _spins_num)
+                cpu_relax();
+            else
+                std::this_thread::yield();
+        }
+    }
+};
+
+// Hashtable lock policies, define how hashtable buckets are protected
+// ResizeMutex keeps buckets in place, it is taken shared by every item operation and exclusively by rehashing, clearing and reserving,
+// GlobalMutex protects the whole hashtable, it is taken shared by iterations and exclusively by rehashing, clearing and reserving,
+// ItemMutex protects buckets and is either striped or embedded into buckets.
+
+// items mutexes are kept in a separate collection, and every mutex protects several buckets
+struct StripedLocks
+{
+    static constexpr bool embedded = false;
+    using ResizeMutex = DistributedRWLock;
+    using GlobalMutex = std::shared_mutex;
+    using ItemMutex = std::shared_mutex;
+};
+
+// every bucket has its own spin lock placed next to the bucket head, so they share a cache line
+struct BucketLocks
+{
+    static constexpr bool embedded = true;
+    using ResizeMutex = DistributedRWLock;
+    using GlobalMutex = std::shared_mutex;
+    using ItemMutex = SpinLock;
+};
+
+// any combination of mutexes, e.g. CustomLocks<std::shared_mutex, SpinLock, true, std::shared_mutex> for many small tables,
+// which don't need per-core reader counters of the default resize mutex
+template <class GlobalLock, class ItemLock, bool Embedded = false, class ResizeLock = DistributedRWLock>
+struct CustomLocks
+{
+    static constexpr bool embedded = Embedded;
+    using ResizeMutex = ResizeLock;
+    using GlobalMutex = GlobalLock;
+    using ItemMutex = ItemLock;
+};
+
+// read-mostly tables: readers of hot stripes and iterations don't contend on shared reader counters
+using ReadMostlyLocks = CustomLocks<DistributedRWLock, DistributedRWLock>;
+
+// bursty writes to short critical sections: contended stripes spin before parking instead of sleeping in the kernel right away
+using AdaptiveLocks = CustomLocks<std::shared_mutex, AdaptiveMutex>;
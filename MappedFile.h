@@ -0,0 +1,114 @@
+#pragma once
+
+// Read-only memory mapped file
+// Pages are shared with the page cache, so processes mapping the same file share a single copy of it.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    MappedFile(MappedFile&& other) noexcept { swap(other); }
+    MappedFile& operator = (MappedFile&& other) noexcept { MappedFile tmp(std::move(other)); swap(tmp); return *this; }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+    ~MappedFile() noexcept;
+
+    const char* data() const noexcept { return _data; }
+    size_t size() const noexcept { return _size; }
+
+private:
+    const char* _data = nullptr;                            // mapped file data
+    size_t _size = 0;                                       // mapped file size
+#ifdef _WIN32
+    HANDLE _file = INVALID_HANDLE_VALUE;                    // file handle
+    HANDLE _mapping = nullptr;                              // file mapping handle
+#endif
+
+    void swap(MappedFile& other) noexcept;
+};
+
+// constructor, maps the whole file
+// @path - file path
+inline MappedFile::MappedFile(const std::string& path)
+{
+#ifdef _WIN32
+    _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Failed to open file " + path);
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(_file, &file_size))
+    {
+        CloseHandle(_file);
+        throw std::runtime_error("Failed to get file size " + path);
+    }
+    _size = (size_t)file_size.QuadPart;
+
+    if (_size)
+    {
+        _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        _data = _mapping ? (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!_data)
+        {
+            if (_mapping)
+                CloseHandle(_mapping);
+            CloseHandle(_file);
+            throw std::runtime_error("Failed to map file " + path);
+        }
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Failed to open file " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Failed to get file size " + path);
+    }
+    _size = (size_t)st.st_size;
+
+    if (_size)
+    {
+        void* data = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("Failed to map file " + path);
+        }
+        _data = (const char*)data;
+    }
+
+    // mapping stays valid after the file is closed
+    close(fd);
+#endif
+}
+
+// destructor, unmaps the file
+inline MappedFile::~MappedFile() noexcept
+{
+#ifdef _WIN32
+    if (_data)
+        UnmapViewOfFile(_data);
+    if (_mapping)
+        CloseHandle(_mapping);
+    if (_file != INVALID_HANDLE_VALUE)
+        CloseHandle(_file);
+#else
+    if (_data)
+        munmap((void*)_data, _size);
+#endif
+}
+
+// exchange mappings
+// @other - mapping to exchange with
+inline void MappedFile::swap(MappedFile& other) noexcept
+{
+    std::swap(_data, other._data);
+    std::swap(_size, other._size);
+#ifdef _WIN32
+    std::swap(_file, other._file);
+    std::swap(_mapping, other._mapping);
+#endif
+}
@@ -0,0 +1,303 @@
+#pragma once
+#include "PerfectHash.h"
+#include "MappedFile.h"
+#include "Serializer.h"
+
+// Read-only hash table opened from a flat position independent image file by memory mapping
+// Image contains a minimal perfect hash function and records, stored by Serializer, in native byte order:
+// header, records (uint32_t key length, key bytes, uint32_t value length, value bytes) in the order they were written,
+// buckets pilots (uint32_t each), remapped positions (uint64_t each), records offsets ordered by key position (uint64_t each).
+// Records are written as items are visited, so that only keys hashes and records offsets are kept in memory while writing.
+// Lookups run directly against the mapping, so no items are materialized while opening,
+// and processes opening the same image share the page cache copy of it.
+// Key is compared by its serialized bytes, value is deserialized by at/find only (find_bytes returns raw bytes).
+// If item with specified key not found exception will be thrown.
+template <class KeyType, class ValType>
+class MappedHashTable
+{
+public:
+    MappedHashTable() = default;
+    explicit MappedHashTable(const std::string& path);
+
+    template <class Range> static void write(const std::string& path, const Range& items);
+    template <class VisitFunc> static void write_items(const std::string& path, VisitFunc visit);
+
+    // data access methods
+    size_t size() const noexcept { return (size_t)_header._items_num; }
+    bool contains(const KeyType& key) const;
+    ValType at(const KeyType& key) const;
+    bool find(const KeyType& key, ValType& val) const;
+    bool find_bytes(const KeyType& key, std::string_view& bytes) const;
+
+    // iteration methods
+    template <class Func> void for_each(Func fn) const;
+
+private:
+    static constexpr uint32_t _file_magic = 0x49544843;     // image file signature, "CHTI"
+    static constexpr uint32_t _file_version = 2;            // image file format version
+    static const size_t _write_buffer_size = 1 << 16;       // records bytes buffered before they are written to file
+
+    // image file header
+    struct Header
+    {
+        uint32_t _magic;
+        uint32_t _version;
+        uint64_t _items_num;
+        uint64_t _buckets_num;
+        uint64_t _remap_num;
+        uint64_t _seed;
+        uint64_t _pilots_offset;
+        uint64_t _remap_offset;
+        uint64_t _offsets_offset;
+    };
+
+    MappedFile _file;                                       // mapped image
+    Header _header = {};                                    // image header
+    const uint32_t* _pilots = nullptr;                      // buckets pilots in the mapping
+    const uint64_t* _remap = nullptr;                       // remapped positions in the mapping
+    const uint64_t* _offsets = nullptr;                     // records offsets in the mapping
+
+    bool find_record(const KeyType& key, std::string_view& val_bytes) const;
+    bool read_record(const size_t pos, std::string_view& key_bytes, std::string_view& val_bytes) const noexcept;
+    static std::string_view key_bytes(const KeyType& key);
+};
+
+// constructor, opens image file
+// @path - image file path
+template <class KeyType, class ValType>
+MappedHashTable<KeyType, ValType>::MappedHashTable(const std::string& path) : _file(path)
+{
+    size_t file_size = _file.size();
+    if (file_size < sizeof(Header))
+        throw std::runtime_error("Invalid image file " + path);
+
+    std::memcpy(&_header, _file.data(), sizeof(Header));
+    bool valid = _header._magic == _file_magic && _header._version == _file_version &&
+                 (_header._items_num == 0 || _header._buckets_num != 0) &&
+                 _header._pilots_offset % sizeof(uint64_t) == 0 && _header._remap_offset % sizeof(uint64_t) == 0 &&
+                 _header._offsets_offset % sizeof(uint64_t) == 0 &&
+                 _header._pilots_offset <= file_size && _header._buckets_num <= (file_size - _header._pilots_offset) / sizeof(uint32_t) &&
+                 _header._remap_offset <= file_size && _header._remap_num <= (file_size - _header._remap_offset) / sizeof(uint64_t) &&
+                 _header._offsets_offset <= file_size && _header._items_num <= (file_size - _header._offsets_offset) / sizeof(uint64_t);
+    if (!valid)
+        throw std::runtime_error("Invalid image file " + path);
+
+    // mapping is page aligned, so are the sections
+    _pilots = reinterpret_cast<const uint32_t*>(_file.data() + _header._pilots_offset);
+    _remap = reinterpret_cast<const uint64_t*>(_file.data() + _header._remap_offset);
+    _offsets = reinterpret_cast<const uint64_t*>(_file.data() + _header._offsets_offset);
+}
+
+// write image file
+// @path - image file path
+// @items - range of key/value pairs with unique keys
+template <class KeyType, class ValType>
+template <class Range>
+void MappedHashTable<KeyType, ValType>::write(const std::string& path, const Range& items)
+{
+    write_items(path, [&](auto& add)
+    {
+        for (const auto& item : items)
+            add(item.first, item.second);
+    });
+}
+
+// write image file of items visited by a function, records are written while items are visited
+// @path - image file path
+// @visit - called as visit(add), calls add(const KeyType& key, const ValType& val) for every item, keys must be unique
+template <class KeyType, class ValType>
+template <class VisitFunc>
+void MappedHashTable<KeyType, ValType>::write_items(const std::string& path, VisitFunc visit)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Failed to open file " + path);
+
+    // header is written last, when sections sizes are known, so it is left zeroed meanwhile
+    std::vector<uint64_t> hashes;
+    std::vector<uint64_t> records_offsets;
+    std::string buffer(sizeof(Header), '\0');
+    uint64_t offset = 0;
+    std::string key, val;
+    auto add = [&](const KeyType& item_key, const ValType& item_val)
+    {
+        key.clear();
+        val.clear();
+        Serializer<KeyType>::write(key, item_key);
+        Serializer<ValType>::write(val, item_val);
+
+        hashes.push_back(hash_bytes(key));
+        records_offsets.push_back(offset + buffer.size());
+        Serializer<uint32_t>::write(buffer, (uint32_t)key.size());
+        buffer.append(key);
+        Serializer<uint32_t>::write(buffer, (uint32_t)val.size());
+        buffer.append(val);
+
+        if (buffer.size() >= _write_buffer_size)
+        {
+            file.write(buffer.data(), buffer.size());
+            offset += buffer.size();
+            buffer.clear();
+        }
+    };
+    visit(add);
+
+    PerfectHash hash;
+    if (!hash.build(hashes))
+        throw std::invalid_argument("Perfect hash function not found, keys are probably not unique");
+
+    // records offsets are stored in keys positions order
+    size_t items_num = hashes.size();
+    std::vector<uint64_t> offsets(items_num);
+    for (size_t i = 0; i < items_num; ++i)
+        offsets[hash.position(hashes[i])] = records_offsets[i];
+
+    Header header = {};
+    header._magic = _file_magic;
+    header._version = _file_version;
+    header._items_num = items_num;
+    header._buckets_num = hash.pilots().size();
+    header._remap_num = hash.remap().size();
+    header._seed = hash.seed();
+    header._pilots_offset = (offset + buffer.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+    header._remap_offset = (header._pilots_offset + header._buckets_num * sizeof(uint32_t) + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+    header._offsets_offset = header._remap_offset + header._remap_num * sizeof(uint64_t);
+
+    buffer.resize((size_t)(header._offsets_offset - offset), '\0');
+    if (header._buckets_num)
+        std::memcpy(&buffer[(size_t)(header._pilots_offset - offset)], hash.pilots().data(), (size_t)header._buckets_num * sizeof(uint32_t));
+    if (header._remap_num)
+        std::memcpy(&buffer[(size_t)(header._remap_offset - offset)], hash.remap().data(), (size_t)header._remap_num * sizeof(uint64_t));
+    file.write(buffer.data(), buffer.size());
+    file.write(reinterpret_cast<const char*>(offsets.data()), items_num * sizeof(uint64_t));
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    file.flush();
+    if (!file)
+        throw std::runtime_error("Failed to write file " + path);
+}
+
+// checks whether item with specified key exists
+// @key - value key
+template <class KeyType, class ValType>
+bool MappedHashTable<KeyType, ValType>::contains(const KeyType& key) const
+{
+    std::string_view val_bytes;
+    return find_record(key, val_bytes);
+}
+
+// get copy of item value by key
+// @key - value key
+template <class KeyType, class ValType>
+ValType MappedHashTable<KeyType, ValType>::at(const KeyType& key) const
+{
+    ValType val;
+    if (!find(key, val))
+        throw std::out_of_range("Key not found");
+    return val;
+}
+
+// get copy of item value by key
+// @key - value key
+// @val - will contain value if found
+template <class KeyType, class ValType>
+bool MappedHashTable<KeyType, ValType>::find(const KeyType& key, ValType& val) const
+{
+    std::string_view val_bytes;
+    if (!find_record(key, val_bytes))
+        return false;
+
+    const char* pos = val_bytes.data();
+    if (!Serializer<ValType>::read(pos, val_bytes.data() + val_bytes.size(), val))
+        throw std::runtime_error("Invalid image record");
+    return true;
+}
+
+// get serialized item value by key, bytes point into the mapping and live as long as the table
+// @key - value key
+// @bytes - will contain value bytes if found
+template <class KeyType, class ValType>
+bool MappedHashTable<KeyType, ValType>::find_bytes(const KeyType& key, std::string_view& bytes) const
+{
+    return find_record(key, bytes);
+}
+
+// visit all items
+// @fn - visitor, called as fn(const KeyType& key, const ValType& val)
+template <class KeyType, class ValType>
+template <class Func>
+void MappedHashTable<KeyType, ValType>::for_each(Func fn) const
+{
+    for (size_t i = 0; i < size(); ++i)
+    {
+        std::string_view key_bytes, val_bytes;
+        if (!read_record(i, key_bytes, val_bytes))
+            throw std::runtime_error("Invalid image record");
+
+        KeyType key;
+        ValType val;
+        const char* key_pos = key_bytes.data();
+        const char* val_pos = val_bytes.data();
+        if (!Serializer<KeyType>::read(key_pos, key_bytes.data() + key_bytes.size(), key) ||
+            !Serializer<ValType>::read(val_pos, val_bytes.data() + val_bytes.size(), val))
+            throw std::runtime_error("Invalid image record");
+
+        fn(key, val);
+    }
+}
+
+// find item record by key
+// @key - item key
+// @val_bytes - will contain value bytes if found
+template <class KeyType, class ValType>
+bool MappedHashTable<KeyType, ValType>::find_record(const KeyType& key, std::string_view& val_bytes) const
+{
+    if (_header._items_num == 0)
+        return false;
+
+    std::string_view bytes = key_bytes(key);
+    size_t pos = PerfectHash::position(_pilots, (size_t)_header._buckets_num, _remap, (size_t)_header._remap_num,
+                                       (size_t)_header._items_num, _header._seed, hash_bytes(bytes));
+    if (pos >= _header._items_num)
+        return false; // remapped position of a corrupted image
+
+    std::string_view record_key;
+    return read_record(pos, record_key, val_bytes) && record_key == bytes;
+}
+
+// read record key and value bytes
+// @pos - record position
+// @key_bytes - will contain key bytes
+// @val_bytes - will contain value bytes
+// returns false if record is out of file bounds
+template <class KeyType, class ValType>
+bool MappedHashTable<KeyType, ValType>::read_record(const size_t pos, std::string_view& key_bytes, std::string_view& val_bytes) const noexcept
+{
+    const char* end = _file.data() + _file.size();
+    if (_offsets[pos] > _file.size())
+        return false;
+
+    uint32_t key_len = 0, val_len = 0;
+    const char* data = _file.data() + _offsets[pos];
+    if (!Serializer<uint32_t>::read(data, end, key_len) || (size_t)(end - data) < key_len)
+        return false;
+    key_bytes = std::string_view(data, key_len);
+    data += key_len;
+
+    if (!Serializer<uint32_t>::read(data, end, val_len) || (size_t)(end - data) < val_len)
+        return false;
+    val_bytes = std::string_view(data, val_len);
+    return true;
+}
+
+// serialize key into a per-thread buffer, so that lookups don't allocate
+// @key - key to serialize
+template <class KeyType, class ValType>
+std::string_view MappedHashTable<KeyType, ValType>::key_bytes(const KeyType& key)
+{
+    thread_local std::string buffer;
+    buffer.clear();
+    Serializer<KeyType>::write(buffer, key);
+    return buffer;
+}
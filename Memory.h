@@ -0,0 +1,373 @@
+#pragma once
+#include "StripedCounter.h"
+#include "Locks.h"
+
+// get NUMA nodes number
+inline size_t numa_nodes_num() noexcept
+{
+    static const size_t nodes_num = []
+    {
+#ifdef _WIN32
+        ULONG highest_node = 0;
+        return GetNumaHighestNodeNumber(&highest_node) ? (size_t)highest_node + 1 : (size_t)1;
+#else
+        size_t num = 0;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error))
+        {
+            std::string name = entry.path().filename().string();
+            if (name.size() > 4 && name.compare(0, 4, "node") == 0 && std::isdigit((unsigned char)name[4]))
+                num++;
+        }
+        return num ? num : (size_t)1;
+#endif
+    }();
+    return nodes_num;
+}
+
+// get NUMA node of the processor the calling thread runs on
+// node is cached per thread and refreshed every few calls, as threads rarely migrate between nodes
+inline size_t numa_current_node() noexcept
+{
+    static const unsigned refresh_period = 256;
+    static thread_local unsigned calls = 0;
+    static thread_local size_t node = 0;
+
+    if (numa_nodes_num() > 1 && calls++ % refresh_period == 0)
+    {
+#ifdef _WIN32
+        PROCESSOR_NUMBER processor;
+        USHORT processor_node = 0;
+        GetCurrentProcessorNumberEx(&processor);
+        if (GetNumaProcessorNodeEx(&processor, &processor_node))
+            node = processor_node % numa_nodes_num();
+#else
+        unsigned cpu = 0, cpu_node = 0;
+        if (syscall(SYS_getcpu, &cpu, &cpu_node, nullptr) == 0)
+            node = cpu_node % numa_nodes_num();
+#endif
+    }
+
+    return node;
+}
+
+// kind of memory pages
+enum class PageKind
+{
+    regular,                                                // regular pages
+    transparent_huge,                                       // regular pages which kernel is advised to merge into huge pages
+    huge                                                    // explicit huge pages
+};
+
+// huge page size, 0 if huge pages are not supported
+inline size_t huge_page_size() noexcept
+{
+#ifdef _WIN32
+    static const size_t page_size = GetLargePageMinimum();
+    return page_size;
+#else
+    return (size_t)1 << 21;
+#endif
+}
+
+// round memory size up to huge page size
+// @bytes - memory size
+inline size_t huge_page_round(const size_t bytes) noexcept
+{
+    size_t page_size = huge_page_size();
+    return page_size ? (bytes + page_size - 1) / page_size * page_size : bytes;
+}
+
+// allocate memory pages on NUMA node, pages are placed on the preferred node when they are first touched
+// Huge pages are tried first if requested: explicit huge pages, then transparent huge pages (Linux only), then regular pages.
+// @bytes - memory size
+// @node - NUMA node, or -1 to interleave pages across all nodes
+// @huge_pages - whether huge pages should be used
+// @kind - will contain kind of obtained pages
+inline void* numa_alloc(size_t bytes, const int node, const bool huge_pages = false, PageKind* kind = nullptr)
+{
+    size_t nodes_num = numa_nodes_num();
+    PageKind obtained = PageKind::regular;
+#ifdef _WIN32
+    void* mem = nullptr;
+    if (huge_pages && huge_page_size())
+    {
+        // large pages need SeLockMemoryPrivilege, so they might be unavailable
+        bytes = huge_page_round(bytes);
+        DWORD flags = MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES;
+        mem = node >= 0 && nodes_num > 1 ? VirtualAllocExNuma(GetCurrentProcess(), nullptr, bytes, flags, PAGE_READWRITE, (DWORD)node)
+                                         : VirtualAlloc(nullptr, bytes, flags, PAGE_READWRITE);
+        if (mem)
+            obtained = PageKind::huge;
+    }
+
+    if (!mem)
+    {
+        if (nodes_num == 1)
+            mem = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        else if (node >= 0)
+            mem = VirtualAllocExNuma(GetCurrentProcess(), nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, (DWORD)node);
+        else
+        {
+            // there is no interleaving policy, so commit chunks of reserved range on nodes one by one
+            static const size_t chunk_size = 1 << 16;
+            mem = VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_READWRITE);
+            for (size_t offset = 0; mem && offset < bytes; offset += chunk_size)
+            {
+                if (!VirtualAllocExNuma(GetCurrentProcess(), (char*)mem + offset, std::min(chunk_size, bytes - offset),
+                                        MEM_COMMIT, PAGE_READWRITE, (DWORD)((offset / chunk_size) % nodes_num)))
+                {
+                    VirtualFree(mem, 0, MEM_RELEASE);
+                    mem = nullptr;
+                }
+            }
+        }
+    }
+
+    if (!mem)
+        throw std::bad_alloc();
+#else
+    void* mem = MAP_FAILED;
+    if (huge_pages)
+    {
+        bytes = huge_page_round(bytes);
+
+        // explicit huge pages must be reserved by administrator, so they might be unavailable
+        mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED)
+            obtained = PageKind::huge;
+        else
+        {
+            // transparent huge pages need a huge page aligned range, so map a bigger one and trim it
+            size_t page_size = huge_page_size();
+            char* range = (char*)mmap(nullptr, bytes + page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (range != (char*)MAP_FAILED)
+            {
+                char* aligned = (char*)(((uintptr_t)range + page_size - 1) / page_size * page_size);
+                if (aligned != range)
+                    munmap(range, aligned - range);
+                if (aligned + bytes != range + bytes + page_size)
+                    munmap(aligned + bytes, range + page_size - aligned);
+
+                mem = aligned;
+                if (madvise(mem, bytes, MADV_HUGEPAGE) == 0)
+                    obtained = PageKind::transparent_huge;
+            }
+        }
+    }
+    else
+        mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (mem == MAP_FAILED)
+        throw std::bad_alloc();
+
+    // bind memory policy of the range, failure is not fatal as memory is still usable with the default policy
+    if (nodes_num > 1)
+    {
+        static const int mpol_preferred = 1;
+        static const int mpol_interleave = 3;
+        static const size_t mask_bits = 8 * sizeof(unsigned long);
+
+        std::vector<unsigned long> mask((nodes_num + mask_bits - 1) / mask_bits, 0);
+        for (size_t i = 0; i < nodes_num; ++i)
+        {
+            if (node < 0 || (size_t)node == i)
+                mask[i / mask_bits] |= 1ul << (i % mask_bits);
+        }
+        syscall(SYS_mbind, mem, bytes, node < 0 ? mpol_interleave : mpol_preferred, mask.data(), nodes_num + 1, 0);
+    }
+#endif
+
+    if (kind)
+        *kind = obtained;
+    return mem;
+}
+
+// free memory allocated by numa_alloc
+// @mem - memory
+// @bytes - memory size
+// @huge_pages - whether huge pages were requested
+inline void numa_free(void* mem, const size_t bytes, const bool huge_pages = false) noexcept
+{
+#ifdef _WIN32
+    (void)bytes;
+    (void)huge_pages;
+    VirtualFree(mem, 0, MEM_RELEASE);
+#else
+    munmap(mem, huge_pages ? huge_page_round(bytes) : bytes);
+#endif
+}
+
+// Hashtable memory policies, define where buckets arrays and items are allocated
+// Policy is a member of hashtable, so it might keep per hashtable state. It provides:
+//   void* allocate_buckets(size_t bytes), void free_buckets(void* mem, size_t bytes) - buckets arrays
+//   void* allocate_item(size_t bytes, size_t alignment), void free_item(void* mem, size_t bytes) - items of the same size
+
+// everything is allocated from the default heap
+struct HeapMemory
+{
+    void* allocate_buckets(const size_t bytes) { return ::operator new(bytes); }
+    void free_buckets(void* mem, const size_t) noexcept { ::operator delete(mem); }
+    void* allocate_item(const size_t bytes, const size_t) { return ::operator new(bytes); }
+    void free_item(void* mem, const size_t) noexcept { ::operator delete(mem); }
+};
+
+// NUMA aware allocation
+// Buckets arrays pages are interleaved across nodes, so that lookups from all nodes see the same average latency,
+// and items are allocated from pools of the node the allocating thread runs on.
+// If node is specified, everything is allocated on that node (used by ReplicatedHashTable replicas).
+// Freed item returns to a pool of its own node, which is stored in a small header in front of the item,
+// header size is fixed, so items aligned stricter than std::max_align_t are not supported.
+// Buckets arrays and pools slabs might be backed by huge pages, kinds of obtained pages are reported.
+// Small hashtable fits TLB anyway and would waste most of a huge page, so regular pages are used until
+// buckets array or items slabs grow big enough for huge pages to pay off.
+class NumaMemory
+{
+public:
+    explicit NumaMemory(const int node = -1, const bool huge_pages = false) : _state(std::make_shared<State>(huge_pages)), _node(node) {}
+
+    void* allocate_buckets(const size_t bytes);
+    void free_buckets(void* mem, const size_t bytes) noexcept { numa_free(mem, bytes, huge_buckets(bytes)); }
+    void* allocate_item(const size_t bytes, const size_t alignment);
+    void free_item(void* mem, const size_t bytes) noexcept;
+    int node() const noexcept { return _node; }
+    PageKind buckets_pages() const noexcept { return _state->_buckets_pages.load(std::memory_order_relaxed); }
+    PageKind slabs_pages() const noexcept { return _state->_slabs_pages.load(std::memory_order_relaxed); }
+
+private:
+    static const size_t _slab_size = 1 << 21;               // pools get memory from nodes by slabs of this size, a huge page
+    static const size_t _huge_pages_min = 1 << 23;          // memory size from which huge pages are used, regular pages TLB reach
+    static const size_t _pools_per_node = 4;                // pools of a node, threads of the node are spread over them
+    static constexpr size_t _header = alignof(std::max_align_t); // item header size, keeps items aligned
+
+    // items pool of a node, padded to a cache line to avoid false sharing
+    struct alignas(64) Pool
+    {
+        SpinLock _lock;
+        void* _free = nullptr;                              // free blocks list
+        char* _slab_pos = nullptr;                          // free part of the current slab
+        char* _slab_end = nullptr;
+        std::vector<void*> _slabs;                          // all slabs of the pool
+    };
+
+    // pools shared by copies of the policy
+    struct State
+    {
+        std::unique_ptr<Pool[]> _pools{new Pool[numa_nodes_num() * _pools_per_node]};
+        bool _huge_pages;                                   // whether huge pages are requested
+        std::atomic<size_t> _slabs_num{0};                  // slabs number of all pools
+
+        // kinds of obtained pages of the last buckets array and the last slab
+        std::atomic<PageKind> _buckets_pages{PageKind::regular};
+        std::atomic<PageKind> _slabs_pages{PageKind::regular};
+
+        explicit State(const bool huge_pages) : _huge_pages(huge_pages) {}
+
+        ~State()
+        {
+            // slab is a huge page exactly, so it is freed in the same way whatever pages it got
+            for (size_t i = 0; i < numa_nodes_num() * _pools_per_node; ++i)
+            {
+                for (void* slab : _pools[i]._slabs)
+                    numa_free(slab, _slab_size, _huge_pages);
+            }
+        }
+    };
+
+    std::shared_ptr<State> _state;                          // pools
+    int _node;                                              // node to allocate on, -1 for the current one
+
+    Pool& pool(const size_t node) const noexcept { return _state->_pools[node * _pools_per_node + thread_index() % _pools_per_node]; }
+    bool huge_buckets(const size_t bytes) const noexcept { return _state->_huge_pages && bytes >= _huge_pages_min; }
+};
+
+// allocate buckets array
+// @bytes - array size
+inline void* NumaMemory::allocate_buckets(const size_t bytes)
+{
+    PageKind kind = PageKind::regular;
+    void* mem = numa_alloc(bytes, _node, huge_buckets(bytes), &kind);
+    _state->_buckets_pages.store(kind, std::memory_order_relaxed);
+    return mem;
+}
+
+// allocate item from the current node pool
+// @bytes - item size
+// @alignment - item alignment
+inline void* NumaMemory::allocate_item(const size_t bytes, const size_t alignment)
+{
+    size_t block_size = (_header + bytes + _header - 1) / _header * _header;
+    if (block_size > _slab_size || alignment > _header)
+        throw std::bad_alloc();
+
+    size_t node = _node >= 0 ? (size_t)_node : numa_current_node();
+    Pool& node_pool = pool(node);
+
+    char* block = nullptr;
+    {
+        std::lock_guard<SpinLock> pool_lock(node_pool._lock);
+        if (node_pool._free)
+        {
+            block = (char*)node_pool._free;
+            node_pool._free = *(void**)(block + _header);
+        }
+        else
+        {
+            if ((size_t)(node_pool._slab_end - node_pool._slab_pos) < block_size)
+            {
+                // switch to huge pages once items take more memory than regular pages TLB covers
+                PageKind kind = PageKind::regular;
+                bool huge_slab = _state->_huge_pages && _state->_slabs_num.fetch_add(1, std::memory_order_relaxed) * _slab_size >= _huge_pages_min;
+                char* slab = (char*)numa_alloc(_slab_size, (int)node, huge_slab, &kind);
+                node_pool._slabs.push_back(slab);
+                _state->_slabs_pages.store(kind, std::memory_order_relaxed);
+                node_pool._slab_pos = slab;
+                node_pool._slab_end = slab + _slab_size;
+            }
+
+            block = node_pool._slab_pos;
+            node_pool._slab_pos += block_size;
+        }
+    }
+
+    *(uint32_t*)block = (uint32_t)node;
+    return block + _header;
+}
+
+// return item to the pool of its node
+// @mem - item
+inline void NumaMemory::free_item(void* mem, const size_t) noexcept
+{
+    char* block = (char*)mem - _header;
+    Pool& node_pool = pool(*(uint32_t*)block);
+
+    // link is kept after the header, so that node stays known
+    std::lock_guard<SpinLock> pool_lock(node_pool._lock);
+    *(void**)mem = node_pool._free;
+    node_pool._free = block;
+}
+
+// NUMA aware allocation with buckets arrays and items pools backed by huge pages, so that random lookups miss TLB less
+// Explicit huge pages are used if reserved, transparent huge pages otherwise, and regular pages if neither is available.
+struct HugePageMemory : NumaMemory
+{
+    explicit HugePageMemory(const int node = -1) : NumaMemory(node, true) {}
+};
+
+// Memory policy wrapper, which places the first item of every bucket right into the buckets array
+// Other items of the bucket are allocated by the base policy, so most lookups at low load factor avoid a pointer chase
+// into a separately allocated item. Inline items are moved when buckets array is reallocated by rehashing,
+// so references to values (e.g. returned by ConcurrentHashTable::at) are valid only until the next insert.
+template <class BaseMemory = HeapMemory>
+struct InlineItems : BaseMemory
+{
+    static constexpr bool inline_items = true;
+    using BaseMemory::BaseMemory;
+};
+
+// checks whether memory policy places items inline
+template <class MemoryPolicy, class Enable = void>
+struct is_inline_memory : std::false_type {};
+
+template <class MemoryPolicy>
+struct is_inline_memory<MemoryPolicy, std::enable_if_t<MemoryPolicy::inline_items>> : std::true_type {};
@@ -0,0 +1,185 @@
+#pragma once
+#include "Hash.h"
+
+// Minimal perfect hash function
+// Keys hashes are split into buckets, and every bucket gets a pilot value such that hashes of the bucket,
+// mixed with the pilot, land into distinct free positions (PTHash-like).
+// Pilots are searched in a few percent bigger positions range than keys number, as the last buckets would take millions of tries
+// to hit the last free positions otherwise, and positions beyond keys number are remapped to the positions left free below it,
+// so the function is still minimal.
+// Position computation needs a bucket pilot and the remap array only, so they might be stored anywhere, e.g. in a mapped file.
+class PerfectHash
+{
+public:
+    bool build(const std::vector<uint64_t>& hashes);
+
+    size_t items_num() const noexcept { return _items_num; }
+    uint64_t seed() const noexcept { return _seed; }
+    const std::vector<uint32_t>& pilots() const noexcept { return _pilots; }
+    const std::vector<uint64_t>& remap() const noexcept { return _remap; }
+
+    size_t position(const uint64_t hash) const noexcept
+    {
+        return position(_pilots.data(), _pilots.size(), _remap.data(), _remap.size(), _items_num, _seed, hash);
+    }
+    static size_t position(const uint32_t* pilots, const size_t buckets_num, const uint64_t* remap, const size_t remap_num,
+                           const size_t items_num, const uint64_t seed, const uint64_t hash) noexcept;
+
+private:
+    static const size_t _max_seeds = 16;                    // seeds tried before construction fails
+    static const uint32_t _max_pilot = 1u << 24;            // pilots tried for a bucket before another seed is tried
+    static constexpr double _load_factor = 0.97;            // keys number to positions number ratio
+
+    std::vector<uint32_t> _pilots;                          // buckets pilots
+    std::vector<uint64_t> _remap;                           // free positions below keys number for positions beyond it
+    size_t _items_num = 0;                                  // keys number
+    uint64_t _seed = 0;                                     // hashes seed
+
+    bool try_build(const std::vector<uint64_t>& hashes);
+    static size_t bucket(const uint64_t h, const size_t buckets_num) noexcept;
+};
+
+// build perfect hash function for specified keys hashes
+// @hashes - keys hashes
+// returns false if function is not found, which means hashes are not unique
+inline bool PerfectHash::build(const std::vector<uint64_t>& hashes)
+{
+    _items_num = hashes.size();
+    _pilots.clear();
+    _remap.clear();
+    if (hashes.empty())
+        return true;
+
+    // pilots search might fail for a seed, so try several of them
+    for (size_t i = 0; i < _max_seeds; ++i)
+    {
+        _seed = mix_hash(i + 1);
+        if (try_build(hashes))
+            return true;
+    }
+
+    return false;
+}
+
+// compute key position
+// @pilots - buckets pilots
+// @buckets_num - buckets number
+// @remap - free positions for positions beyond keys number
+// @remap_num - remapped positions number, positions number is keys number + remapped positions number
+// @items_num - keys number
+// @seed - hashes seed
+// @hash - key hash
+inline size_t PerfectHash::position(const uint32_t* pilots, const size_t buckets_num, const uint64_t* remap, const size_t remap_num,
+                                    const size_t items_num, const uint64_t seed, const uint64_t hash) noexcept
+{
+    uint64_t h = mix_hash(hash ^ seed);
+    uint32_t pilot = pilots[bucket(h, buckets_num)];
+    size_t pos = (size_t)(mix_hash(h ^ mix_hash(pilot)) % (items_num + remap_num));
+    return pos < items_num ? pos : (size_t)remap[pos - items_num];
+}
+
+// find buckets pilots with current seed
+// @hashes - keys hashes
+// returns false if pilot of some bucket was not found
+inline bool PerfectHash::try_build(const std::vector<uint64_t>& hashes)
+{
+    // about 7 keys per bucket divided by log2 of keys number, as PTHash suggests
+    size_t log2_num = 1;
+    while (((size_t)1 << log2_num) < _items_num)
+        log2_num++;
+    size_t buckets_num = std::max<size_t>(1, 7 * _items_num / log2_num);
+    _pilots.assign(buckets_num, 0);
+
+    // split keys hashes into buckets by counting sort, so that every bucket hashes are stored together
+    std::vector<size_t> bucket_starts(buckets_num + 1, 0);
+    for (uint64_t hash : hashes)
+        bucket_starts[bucket(mix_hash(hash ^ _seed), buckets_num) + 1]++;
+    for (size_t i = 0; i < buckets_num; ++i)
+        bucket_starts[i + 1] += bucket_starts[i];
+
+    std::vector<uint64_t> seeded(_items_num);
+    std::vector<size_t> bucket_ends(bucket_starts.begin(), bucket_starts.end() - 1);
+    for (uint64_t hash : hashes)
+    {
+        uint64_t h = mix_hash(hash ^ _seed);
+        seeded[bucket_ends[bucket(h, buckets_num)]++] = h;
+    }
+
+    // place the biggest buckets first, while there are many free positions
+    std::vector<size_t> order(buckets_num);
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    auto bucket_size = [&](const size_t bucket_idx) { return bucket_starts[bucket_idx + 1] - bucket_starts[bucket_idx]; };
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return bucket_size(a) > bucket_size(b); });
+
+    size_t positions_num = std::max(_items_num + 1, (size_t)std::ceil(_items_num / _load_factor));
+    std::vector<bool> taken(positions_num, false);
+    std::vector<size_t> positions;
+
+    for (size_t bucket_idx : order)
+    {
+        uint64_t* first = seeded.data() + bucket_starts[bucket_idx];
+        uint64_t* last = seeded.data() + bucket_starts[bucket_idx + 1];
+        if (first == last)
+            break;
+
+        // equal hashes never get distinct positions, so don't search pilots for them
+        std::sort(first, last);
+        if (std::adjacent_find(first, last) != last)
+            return false;
+
+        // find the first pilot which places all bucket keys into distinct free positions
+        uint32_t pilot = 0;
+        for (; pilot < _max_pilot; ++pilot)
+        {
+            positions.clear();
+            uint64_t pilot_hash = mix_hash(pilot);
+            const uint64_t* h = first;
+            for (; h != last; ++h)
+            {
+                size_t pos = (size_t)(mix_hash(*h ^ pilot_hash) % positions_num);
+                if (taken[pos] || std::find(positions.begin(), positions.end(), pos) != positions.end())
+                    break;
+                positions.push_back(pos);
+            }
+
+            if (h == last)
+                break;
+        }
+
+        if (pilot == _max_pilot)
+            return false;
+
+        _pilots[bucket_idx] = pilot;
+        for (size_t pos : positions)
+            taken[pos] = true;
+    }
+
+    // as many positions are free below keys number as are taken beyond it, so map them one to one
+    _remap.assign(positions_num - _items_num, 0);
+    size_t free_pos = 0;
+    for (size_t pos = _items_num; pos < positions_num; ++pos)
+    {
+        if (!taken[pos])
+            continue;
+        while (taken[free_pos])
+            free_pos++;
+        _remap[pos - _items_num] = free_pos++;
+    }
+
+    return true;
+}
+
+// get key bucket, 60% of keys go to 30% of buckets, so that there are many big buckets to place while positions are mostly free,
+// and many small buckets to place into the last free positions (PTHash skewed mapping)
+// @h - seeded key hash
+// @buckets_num - buckets number
+inline size_t PerfectHash::bucket(const uint64_t h, const size_t buckets_num) noexcept
+{
+    size_t dense_num = buckets_num * 3 / 10;
+    if (dense_num == 0)
+        return (size_t)(h % buckets_num);
+    if ((h & 0xFFFFFFFF) < 0x99999999)
+        return (size_t)((h >> 32) % dense_num);
+    return dense_num + (size_t)((h >> 32) % (buckets_num - dense_num));
+}
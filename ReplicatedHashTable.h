@@ -0,0 +1,85 @@
+#pragma once
+#include "ConcurrentHashTable.h"
+
+// Read-mostly hash table replicated per NUMA node
+// Every node has its own replica, whose buckets and items are allocated on that node, and lookups go
+// to the replica of the node the calling thread runs on, so they never touch remote memory.
+// Writes are applied to all replicas one by one under a single write lock, so replicas see writes in the same order,
+// but a lookup on one node might see a write before a lookup on another node does.
+// If item with specified key not found exception will be thrown.
+template <class KeyType, class ValType, class LockPolicy = StripedLocks>
+class ReplicatedHashTable
+{
+public:
+    using Replica = ConcurrentHashTable<KeyType, ValType, LockPolicy, NumaMemory>;
+
+    explicit ReplicatedHashTable(const size_t capacity = 31);
+
+    // data access methods
+    size_t replicas_num() const noexcept { return _replicas.size(); }
+    size_t size() const noexcept { return local().size(); }
+    bool contains(const KeyType& key) const noexcept { return local().contains(key); }
+    const ValType& at(const KeyType& key) { return local().at(key); }
+    bool find(const KeyType& key, ValType& val) const { return local().find(key, val); }
+    void insert(const KeyType& key, const ValType& val);
+    void insert(const KeyType& key, const ValType& val, const std::chrono::milliseconds ttl);
+    void erase(const KeyType& key);
+    void clear();
+
+private:
+    std::vector<std::unique_ptr<Replica>> _replicas;        // replicas by NUMA nodes
+    std::mutex _write_mutex;                                // orders writes to replicas
+
+    Replica& local() const noexcept { return *_replicas[numa_current_node() % _replicas.size()]; }
+};
+
+// constructor
+// @capacity - initial capacity of every replica
+template <class KeyType, class ValType, class LockPolicy>
+ReplicatedHashTable<KeyType, ValType, LockPolicy>::ReplicatedHashTable(const size_t capacity)
+{
+    for (size_t node = 0; node < numa_nodes_num(); ++node)
+        _replicas.push_back(std::make_unique<Replica>(capacity, 0.5f, 2.0f, (float)std::thread::hardware_concurrency(), NumaMemory((int)node)));
+}
+
+// insert item into all replicas or update it if it exists
+// @key - key of item to be inserted
+// @val - value of item to be inserted
+template <class KeyType, class ValType, class LockPolicy>
+void ReplicatedHashTable<KeyType, ValType, LockPolicy>::insert(const KeyType& key, const ValType& val)
+{
+    std::lock_guard<std::mutex> write_lock(_write_mutex);
+    for (auto& replica : _replicas)
+        replica->insert(key, val);
+}
+
+// insert item which expires after specified time into all replicas
+// @key - key of item to be inserted
+// @val - value of item to be inserted
+// @ttl - item time to live
+template <class KeyType, class ValType, class LockPolicy>
+void ReplicatedHashTable<KeyType, ValType, LockPolicy>::insert(const KeyType& key, const ValType& val, const std::chrono::milliseconds ttl)
+{
+    std::lock_guard<std::mutex> write_lock(_write_mutex);
+    for (auto& replica : _replicas)
+        replica->insert(key, val, ttl);
+}
+
+// delete item from all replicas
+// @key - value key
+template <class KeyType, class ValType, class LockPolicy>
+void ReplicatedHashTable<KeyType, ValType, LockPolicy>::erase(const KeyType& key)
+{
+    std::lock_guard<std::mutex> write_lock(_write_mutex);
+    for (auto& replica : _replicas)
+        replica->erase(key);
+}
+
+// delete all items from all replicas
+template <class KeyType, class ValType, class LockPolicy>
+void ReplicatedHashTable<KeyType, ValType, LockPolicy>::clear()
+{
+    std::lock_guard<std::mutex> write_lock(_write_mutex);
+    for (auto& replica : _replicas)
+        replica->clear();
+}
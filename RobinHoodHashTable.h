@@ -0,0 +1,319 @@
+#pragma once
+#include "Hash.h"
+
+// Robin Hood open addressing hash table class, for a single writer and many readers
+// Items are kept right in the slots array with one byte probe distances in a separate array, and insert lets an item take the slot
+// of an item which is closer to its home slot ("rich" one), so probe distances stay short and close to each other even at high load factor.
+// Lookup stops as soon as it meets an item closer to its home slot than the looked up key would be, so misses are as cheap as hits,
+// and erase shifts the following items one slot back instead of leaving tombstones, so items stay contiguous.
+// Readers share the table lock and writers take it exclusively, writers are expected to be rare.
+// If item with specified key not found exception will be thrown.
+template <class KeyType, class ValType>
+class RobinHoodHashTable
+{
+public:
+    // constructor/destructor
+    explicit RobinHoodHashTable(const size_t capacity = 16, const float max_load_factor = 0.9f);
+    ~RobinHoodHashTable() noexcept;
+
+    // data access methods
+    size_t size() const;
+    size_t capacity() const;
+    size_t max_probe_length() const;
+    bool contains(const KeyType& key) const;
+    ValType at(const KeyType& key) const;
+    bool find(const KeyType& key, ValType& val) const;
+    void insert(const KeyType& key, const ValType& val);
+    bool erase(const KeyType& key);
+    void clear();
+    void reserve(const size_t items_num);
+
+    // iteration methods
+    template <class Func> void for_each(Func fn) const;
+
+private:
+    static constexpr uint8_t _max_dist = 255;               // probe distance limit, table grows when it is reached
+
+    struct Entry
+    {
+        KeyType _key;
+        ValType _val;
+    };
+    using Slot = typename std::aligned_storage<sizeof(Entry), alignof(Entry)>::type;
+
+    mutable std::shared_mutex _mutex;                       // table lock, shared by readers
+    std::unique_ptr<uint8_t[]> _dists;                      // probe distances + 1 of slots items, 0 for empty slots
+    std::unique_ptr<Slot[]> _slots;                         // items
+    size_t _mask = 0;                                       // slots number - 1, slots number is a power of 2
+    size_t _size = 0;                                       // items number
+    float _max_load_factor;                                 // max load factor, table grows when it is exceeded
+
+    // auxiliary methods
+    Entry& entry(const size_t idx) noexcept { return *reinterpret_cast<Entry*>(&_slots[idx]); }
+    const Entry& entry(const size_t idx) const noexcept { return *reinterpret_cast<const Entry*>(&_slots[idx]); }
+    static size_t hash(const KeyType& key) noexcept { return (size_t)mix_hash(std::hash<KeyType>()(key)); }
+    size_t find_slot(const KeyType& key) const;
+    void place_entry(Entry&& entry);
+    void rehash(const size_t slots_num);
+    void destroy_entries() noexcept;
+};
+
+// constructor
+// @capacity - initial items capacity
+// @max_load_factor - max load factor, table grows when it is exceeded
+template <class KeyType, class ValType>
+RobinHoodHashTable<KeyType, ValType>::RobinHoodHashTable(const size_t capacity, const float max_load_factor) :
+    _max_load_factor(max_load_factor > 0.0f && max_load_factor < 1.0f ? max_load_factor : 0.9f)
+{
+    size_t slots_num = 8;
+    while (slots_num * _max_load_factor < capacity)
+        slots_num *= 2;
+
+    _dists.reset(new uint8_t[slots_num]());
+    _slots.reset(new Slot[slots_num]);
+    _mask = slots_num - 1;
+}
+
+// destructor
+template <class KeyType, class ValType>
+RobinHoodHashTable<KeyType, ValType>::~RobinHoodHashTable() noexcept
+{
+    destroy_entries();
+}
+
+// get items number
+template <class KeyType, class ValType>
+size_t RobinHoodHashTable<KeyType, ValType>::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    return _size;
+}
+
+// get slots number
+template <class KeyType, class ValType>
+size_t RobinHoodHashTable<KeyType, ValType>::capacity() const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    return _mask + 1;
+}
+
+// get longest probe length, i.e. max number of slots a lookup reads
+template <class KeyType, class ValType>
+size_t RobinHoodHashTable<KeyType, ValType>::max_probe_length() const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    return *std::max_element(_dists.get(), _dists.get() + _mask + 1);
+}
+
+// checks whether item with specified key exists
+// @key - value key
+template <class KeyType, class ValType>
+bool RobinHoodHashTable<KeyType, ValType>::contains(const KeyType& key) const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    return find_slot(key) != (size_t)-1;
+}
+
+// get copy of item value by key, items are shifted by writers, so no reference is returned
+// @key - value key
+template <class KeyType, class ValType>
+ValType RobinHoodHashTable<KeyType, ValType>::at(const KeyType& key) const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    size_t idx = find_slot(key);
+    if (idx == (size_t)-1)
+        throw std::out_of_range("Key not found");
+    return entry(idx)._val;
+}
+
+// get copy of item value by key
+// @key - value key
+// @val - will contain value if found
+template <class KeyType, class ValType>
+bool RobinHoodHashTable<KeyType, ValType>::find(const KeyType& key, ValType& val) const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    size_t idx = find_slot(key);
+    if (idx == (size_t)-1)
+        return false;
+    val = entry(idx)._val;
+    return true;
+}
+
+// insert item or update it if it exists
+// @key - key of item to be inserted
+// @val - value of item to be inserted
+template <class KeyType, class ValType>
+void RobinHoodHashTable<KeyType, ValType>::insert(const KeyType& key, const ValType& val)
+{
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+
+    size_t idx = find_slot(key);
+    if (idx != (size_t)-1)
+    {
+        entry(idx)._val = val;
+        return;
+    }
+
+    if (_size + 1 > (_mask + 1) * _max_load_factor)
+        rehash((_mask + 1) * 2);
+
+    place_entry(Entry{ key, val });
+    _size++;
+}
+
+// delete item, following items are shifted back to close the gap
+// @key - value key
+// returns true if item was deleted
+template <class KeyType, class ValType>
+bool RobinHoodHashTable<KeyType, ValType>::erase(const KeyType& key)
+{
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+
+    size_t idx = find_slot(key);
+    if (idx == (size_t)-1)
+        return false;
+
+    entry(idx).~Entry();
+
+    // shift back items until an empty slot or an item in its home slot
+    for (size_t next = (idx + 1) & _mask; _dists[next] > 1; idx = next, next = (next + 1) & _mask)
+    {
+        new (&_slots[idx]) Entry(std::move(entry(next)));
+        entry(next).~Entry();
+        _dists[idx] = _dists[next] - 1;
+    }
+
+    _dists[idx] = 0;
+    _size--;
+    return true;
+}
+
+// delete all items
+template <class KeyType, class ValType>
+void RobinHoodHashTable<KeyType, ValType>::clear()
+{
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    destroy_entries();
+    _size = 0;
+}
+
+// make room for specified items number, so that inserting them doesn't grow the table
+// @items_num - items number
+template <class KeyType, class ValType>
+void RobinHoodHashTable<KeyType, ValType>::reserve(const size_t items_num)
+{
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+
+    size_t slots_num = _mask + 1;
+    while (slots_num * _max_load_factor < items_num)
+        slots_num *= 2;
+
+    if (slots_num != _mask + 1)
+        rehash(slots_num);
+}
+
+// visit all items in slots order
+// @fn - visitor, called as fn(const KeyType& key, const ValType& val)
+template <class KeyType, class ValType>
+template <class Func>
+void RobinHoodHashTable<KeyType, ValType>::for_each(Func fn) const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    for (size_t i = 0; i <= _mask; ++i)
+    {
+        if (_dists[i])
+            fn(entry(i)._key, entry(i)._val);
+    }
+}
+
+// find slot of item
+// probing stops at the first slot whose item is closer to its home slot than the key would be
+// @key - item key
+// returns -1 if item not found
+template <class KeyType, class ValType>
+size_t RobinHoodHashTable<KeyType, ValType>::find_slot(const KeyType& key) const
+{
+    size_t idx = hash(key) & _mask;
+    for (size_t dist = 1; dist <= _dists[idx]; ++dist, idx = (idx + 1) & _mask)
+    {
+        if (_dists[idx] == dist && entry(idx)._key == key)
+            return idx;
+    }
+    return (size_t)-1;
+}
+
+// place item which is known to be absent, taking slots of items closer to their home slots on the way
+// @entry - item
+template <class KeyType, class ValType>
+void RobinHoodHashTable<KeyType, ValType>::place_entry(Entry&& entry)
+{
+    Entry carried(std::move(entry));
+    size_t idx = hash(carried._key) & _mask;
+    size_t dist = 1;
+
+    for (;;)
+    {
+        if (!_dists[idx])
+        {
+            new (&_slots[idx]) Entry(std::move(carried));
+            _dists[idx] = (uint8_t)dist;
+            return;
+        }
+
+        if (_dists[idx] < dist)
+        {
+            std::swap(carried, this->entry(idx));
+            size_t slot_dist = _dists[idx];
+            _dists[idx] = (uint8_t)dist;
+            dist = slot_dist;
+        }
+
+        idx = (idx + 1) & _mask;
+        if (++dist == _max_dist)
+        {
+            // probe distance doesn't fit its byte, so grow the table and place the carried item again
+            rehash((_mask + 1) * 2);
+            idx = hash(carried._key) & _mask;
+            dist = 1;
+        }
+    }
+}
+
+// move items to a new slots array
+// @slots_num - new slots number, a power of 2
+template <class KeyType, class ValType>
+void RobinHoodHashTable<KeyType, ValType>::rehash(const size_t slots_num)
+{
+    std::unique_ptr<uint8_t[]> old_dists(new uint8_t[slots_num]());
+    std::unique_ptr<Slot[]> old_slots(new Slot[slots_num]);
+    size_t old_slots_num = _mask + 1;
+
+    _dists.swap(old_dists);
+    _slots.swap(old_slots);
+    _mask = slots_num - 1;
+
+    for (size_t i = 0; i < old_slots_num; ++i)
+    {
+        if (old_dists[i])
+        {
+            Entry& old_entry = *reinterpret_cast<Entry*>(&old_slots[i]);
+            place_entry(std::move(old_entry));
+            old_entry.~Entry();
+        }
+    }
+}
+
+// destroy all items
+template <class KeyType, class ValType>
+void RobinHoodHashTable<KeyType, ValType>::destroy_entries() noexcept
+{
+    for (size_t i = 0; i <= _mask; ++i)
+    {
+        if (_dists[i])
+        {
+            entry(i).~Entry();
+            _dists[i] = 0;
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+// Binary serializer of keys and values, used to save and load hashtables
+// Trivially copyable types are stored as raw bytes and strings as length-prefixed bytes,
+// specialize it to store other types:
+//   static void write(std::string& out, const T& val) - append val bytes to out
+//   static bool read(const char*& pos, const char* end, T& val) - read val from [pos, end) and advance pos, false if data is malformed
+template <class T, class Enable = void>
+struct Serializer;
+
+template <class T>
+struct Serializer<T, std::enable_if_t<std::is_trivially_copyable_v<T>>>
+{
+    static void write(std::string& out, const T& val)
+    {
+        out.append(reinterpret_cast<const char*>(&val), sizeof(T));
+    }
+
+    static bool read(const char*& pos, const char* end, T& val)
+    {
+        if ((size_t)(end - pos) < sizeof(T))
+            return false;
+        std::memcpy(&val, pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+};
+
+template <>
+struct Serializer<std::string>
+{
+    static void write(std::string& out, const std::string& val)
+    {
+        Serializer<uint32_t>::write(out, (uint32_t)val.size());
+        out.append(val);
+    }
+
+    static bool read(const char*& pos, const char* end, std::string& val)
+    {
+        uint32_t len = 0;
+        if (!Serializer<uint32_t>::read(pos, end, len) || (size_t)(end - pos) < len)
+            return false;
+        val.assign(pos, len);
+        pos += len;
+        return true;
+    }
+};
+
+// checks whether Serializer is defined for type
+template <class T, class Enable = void>
+struct is_serializable : std::false_type {};
+
+template <class T>
+struct is_serializable<T, std::void_t<decltype(sizeof(Serializer<T>))>> : std::true_type {};
+
+template <class T>
+constexpr bool is_serializable_v = is_serializable<T>::value;
+
+// running checksum of saved data (64-bit FNV-1a)
+class Checksum
+{
+public:
+    void update(const char* data, const size_t len) noexcept
+    {
+        for (size_t i = 0; i < len; ++i)
+            _val = (_val ^ (uint8_t)data[i]) * 0x100000001B3ull;
+    }
+
+    uint64_t value() const noexcept { return _val; }
+
+private:
+    uint64_t _val = 0xCBF29CE484222325ull;
+};
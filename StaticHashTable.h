@@ -0,0 +1,140 @@
+#pragma once
+#include "Hash.h"
+
+// compile-time hash function, defined for integral and enumeration types and for std::string_view
+// specialize it to use other key types in StaticHashTable
+template <class KeyType>
+struct StaticHash
+{
+    static_assert(std::is_integral_v<KeyType> || std::is_enum_v<KeyType>, "StaticHash is not defined for key type");
+    constexpr uint64_t operator()(const KeyType key) const noexcept { return mix_hash((uint64_t)key); }
+};
+
+template <>
+struct StaticHash<std::string_view>
+{
+    constexpr uint64_t operator()(const std::string_view key) const noexcept { return hash_bytes(key); }
+};
+
+// Immutable fixed size hash table, which might be entirely built at compile time
+// Items are placed by linear probing into arrays of power of two capacity, at least twice bigger than items number,
+// so constexpr table is baked into read-only data and needs neither construction at startup nor synchronization.
+// Key and value types must be literal types, duplicate keys break compilation of constexpr table.
+// If item with specified key not found exception will be thrown.
+template <class KeyType, class ValType, size_t ItemsNum, class Hash = StaticHash<KeyType>>
+class StaticHashTable
+{
+public:
+    constexpr explicit StaticHashTable(const std::pair<KeyType, ValType> (&items)[ItemsNum]);
+
+    // data access methods
+    constexpr size_t size() const noexcept { return ItemsNum; }
+    constexpr bool contains(const KeyType& key) const noexcept { return find_idx(key) != _capacity; }
+    constexpr const ValType& at(const KeyType& key) const;
+    constexpr bool find(const KeyType& key, ValType& val) const;
+
+    // iteration methods
+    template <class Func> void for_each(Func fn) const;
+
+private:
+    static constexpr size_t capacity_for(const size_t items_num) noexcept;
+    static constexpr size_t _capacity = capacity_for(ItemsNum);
+
+    KeyType _keys[_capacity] = {};                          // items keys
+    ValType _vals[_capacity] = {};                          // items values
+    bool _used[_capacity] = {};                             // whether item slot is occupied
+
+    constexpr size_t find_idx(const KeyType& key) const noexcept;
+};
+
+// constructor
+// @items - items with unique keys
+template <class KeyType, class ValType, size_t ItemsNum, class Hash>
+constexpr StaticHashTable<KeyType, ValType, ItemsNum, Hash>::StaticHashTable(const std::pair<KeyType, ValType> (&items)[ItemsNum])
+{
+    for (size_t i = 0; i < ItemsNum; ++i)
+    {
+        size_t idx = Hash()(items[i].first) & (_capacity - 1);
+        while (_used[idx])
+        {
+            if (_keys[idx] == items[i].first)
+                throw std::invalid_argument("Duplicate key");
+            idx = (idx + 1) & (_capacity - 1);
+        }
+
+        _keys[idx] = items[i].first;
+        _vals[idx] = items[i].second;
+        _used[idx] = true;
+    }
+}
+
+// get item by key
+// @key - value key
+template <class KeyType, class ValType, size_t ItemsNum, class Hash>
+constexpr const ValType& StaticHashTable<KeyType, ValType, ItemsNum, Hash>::at(const KeyType& key) const
+{
+    size_t idx = find_idx(key);
+    if (idx == _capacity)
+        throw std::out_of_range("Key not found");
+    return _vals[idx];
+}
+
+// get copy of item value by key
+// @key - value key
+// @val - will contain value if found
+template <class KeyType, class ValType, size_t ItemsNum, class Hash>
+constexpr bool StaticHashTable<KeyType, ValType, ItemsNum, Hash>::find(const KeyType& key, ValType& val) const
+{
+    size_t idx = find_idx(key);
+    if (idx != _capacity)
+        val = _vals[idx];
+    return idx != _capacity;
+}
+
+// visit all items
+// @fn - visitor, called as fn(const KeyType& key, const ValType& val)
+template <class KeyType, class ValType, size_t ItemsNum, class Hash>
+template <class Func>
+void StaticHashTable<KeyType, ValType, ItemsNum, Hash>::for_each(Func fn) const
+{
+    for (size_t i = 0; i < _capacity; ++i)
+        if (_used[i])
+            fn(_keys[i], _vals[i]);
+}
+
+// get capacity for specified items number
+// power of two, at least twice bigger than items number, so probe sequences stay short
+// @items_num - items number
+template <class KeyType, class ValType, size_t ItemsNum, class Hash>
+constexpr size_t StaticHashTable<KeyType, ValType, ItemsNum, Hash>::capacity_for(const size_t items_num) noexcept
+{
+    size_t capacity = 1;
+    while (capacity < items_num * 2)
+        capacity *= 2;
+    return capacity;
+}
+
+// find item slot by key
+// @key - item key
+// returns capacity if not found
+template <class KeyType, class ValType, size_t ItemsNum, class Hash>
+constexpr size_t StaticHashTable<KeyType, ValType, ItemsNum, Hash>::find_idx(const KeyType& key) const noexcept
+{
+    size_t idx = Hash()(key) & (_capacity - 1);
+    while (_used[idx])
+    {
+        if (_keys[idx] == key)
+            return idx;
+        idx = (idx + 1) & (_capacity - 1);
+    }
+    return _capacity;
+}
+
+// build static hashtable, number of items is deduced from initializer list
+// @items - items with unique keys
+// example: constexpr auto opcodes = make_static_hash_table<std::string_view, int>({ { "GET", 1 }, { "PUT", 2 } });
+template <class KeyType, class ValType, class Hash = StaticHash<KeyType>, size_t ItemsNum>
+constexpr StaticHashTable<KeyType, ValType, ItemsNum, Hash> make_static_hash_table(const std::pair<KeyType, ValType> (&items)[ItemsNum])
+{
+    return StaticHashTable<KeyType, ValType, ItemsNum, Hash>(items);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+// get calling thread index, threads are numbered sequentially so that they spread evenly over per thread data
+inline size_t thread_index() noexcept
+{
+    static std::atomic<size_t> threads_num{0};
+    static thread_local size_t idx = threads_num.fetch_add(1, std::memory_order_relaxed);
+    return idx;
+}
+
+// Scalable concurrent counter
+// Every thread updates its own cache line sized cell, and a cell is folded into the shared total only
+// when its value exceeds the batch size, so the shared cache line is written once per batch of updates.
+// Approximate value is read with a single load and differs from the exact one by less than cells number * batch size.
+class StripedCounter
+{
+public:
+    explicit StripedCounter(const size_t cells_num = std::thread::hardware_concurrency(), const size_t batch = 1);
+
+    void add(const ptrdiff_t delta) noexcept;
+    size_t approximate() const noexcept;
+    size_t exact() const noexcept;
+    void reset() noexcept;
+    void set_batch(const size_t batch) noexcept { _batch.store((ptrdiff_t)(batch ? batch : 1), std::memory_order_relaxed); }
+    size_t cells_num() const noexcept { return _cells_num; }
+
+private:
+    // thread local part of the counter, padded to a cache line to avoid false sharing
+    struct alignas(64) Cell
+    {
+        std::atomic<ptrdiff_t> _val{0};
+    };
+
+    std::unique_ptr<Cell[]> _cells;                         // threads cells
+    size_t _cells_num;                                      // cells number
+    std::atomic<ptrdiff_t> _batch;                          // cell value folded into total when exceeded
+    alignas(64) std::atomic<ptrdiff_t> _total{0};           // folded cells values
+};
+
+// constructor
+// @cells_num - cells number, usually the number of cores
+// @batch - cell value which is folded into total when exceeded
+inline StripedCounter::StripedCounter(const size_t cells_num, const size_t batch) :
+    _cells_num(cells_num ? cells_num : 1),
+    _batch((ptrdiff_t)(batch ? batch : 1))
+{
+    _cells.reset(new Cell[_cells_num]);
+}
+
+// add delta to the calling thread cell and fold the cell into total if batch is exceeded
+// @delta - value to add, might be negative
+inline void StripedCounter::add(const ptrdiff_t delta) noexcept
+{
+    Cell& cell = _cells[thread_index() % _cells_num];
+
+    ptrdiff_t val = cell._val.fetch_add(delta, std::memory_order_relaxed) + delta;
+    if (val >= _batch.load(std::memory_order_relaxed) || -val >= _batch.load(std::memory_order_relaxed))
+        _total.fetch_add(cell._val.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// get approximate value, cheap enough to be called on every operation
+inline size_t StripedCounter::approximate() const noexcept
+{
+    ptrdiff_t total = _total.load(std::memory_order_relaxed);
+    return total > 0 ? (size_t)total : 0;
+}
+
+// get exact value
+// value is exact only if there are no concurrent updates, otherwise it is a sum of all cells read one by one
+inline size_t StripedCounter::exact() const noexcept
+{
+    ptrdiff_t total = _total.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < _cells_num; ++i)
+        total += _cells[i]._val.load(std::memory_order_relaxed);
+    return total > 0 ? (size_t)total : 0;
+}
+
+// reset counter to zero
+// must not be called concurrently with updates
+inline void StripedCounter::reset() noexcept
+{
+    for (size_t i = 0; i < _cells_num; ++i)
+        _cells[i]._val.store(0, std::memory_order_relaxed);
+    _total.store(0, std::memory_order_relaxed);
+}
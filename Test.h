@@ -13,8 +13,34 @@ private:
     static void test_insert();
     static void test_update();
     static void test_erase();
+    static void test_erase_if();
     static void test_clear();
+    static void test_ttl();
     static void test_rehash();
+    static void test_size();
+    static void test_bucket_locks();
+    static void test_lock_policies();
+    static void test_concurrent_writers();
+    static void test_adaptive_stripes();
+    static void test_numa();
+    static void test_huge_pages();
+    static void test_inline_items();
+    static void test_cuckoo();
+    static void test_robin_hood();
+    static void test_hopscotch();
+    static void test_for_each();
+    static void test_snapshot();
+    static void test_frozen();
+    static void test_static();
+    static void test_save_load();
+    static void test_mapped();
+    static void test_durable();
+    static void test_parallel();
+    static void test_set();
+    static void test_multimap();
+    static void test_counter_map();
+    static void test_cache();
+    static void test_tiny_lfu();
     static void test_multithreaded();
 
     static void thread_func(ConcurrentHashTable<uint16_t, std::string>& ht, std::atomic_bool& work_flag, std::mutex& print_mutex);
@@ -26,8 +52,34 @@ void Test::start()
     test_insert();
     test_update();
     test_erase();
+    test_erase_if();
     test_clear();
+    test_ttl();
     test_rehash();
+    test_size();
+    test_bucket_locks();
+    test_lock_policies();
+    test_concurrent_writers();
+    test_adaptive_stripes();
+    test_numa();
+    test_huge_pages();
+    test_inline_items();
+    test_cuckoo();
+    test_robin_hood();
+    test_hopscotch();
+    test_for_each();
+    test_snapshot();
+    test_frozen();
+    test_static();
+    test_save_load();
+    test_mapped();
+    test_durable();
+    test_parallel();
+    test_set();
+    test_multimap();
+    test_counter_map();
+    test_cache();
+    test_tiny_lfu();
     test_multithreaded();
 }
 
@@ -72,6 +124,23 @@ void Test::test_erase()
     std::cout << (res ? "passed" : "failed") << std::endl;
 }
 
+void Test::test_erase_if()
+{
+    std::cout << "erase_if test:\t\t";
+
+    ConcurrentHashTable<uint16_t, std::string> ht(7, 0.5, 2.0);
+    for (uint16_t i = 0; i < 100; ++i)
+        ht.insert(i, std::to_string(i));
+
+    size_t erased = ht.erase_if([](const uint16_t& key, const std::string&) { return key % 3 == 0; });
+    bool res = (erased == 34);
+    res = res && (ht.size_exact() == 66);
+    for (uint16_t i = 0; i < 100; ++i)
+        res = res && (ht.contains(i) == (i % 3 != 0));
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
 void Test::test_clear()
 {
     std::cout << "clear test:\t\t";
@@ -84,6 +153,35 @@ void Test::test_clear()
     std::cout << (res ? "passed" : "failed") << std::endl;
 }
 
+void Test::test_ttl()
+{
+    std::cout << "ttl test:\t\t";
+
+    ConcurrentHashTable<uint16_t, std::string> ht;
+    ht.insert(0, "val0", std::chrono::milliseconds(20));
+    ht.insert(1, "val1", std::chrono::hours(1));
+    ht.insert(2, "val2");
+    bool res = ht.contains(0) && (ht[0] == "val0");
+
+    // time to live is extended, shortened and removed
+    ht.insert(3, "val3", std::chrono::milliseconds(20));
+    ht.insert(3, "val3_upd", std::chrono::hours(1));
+    ht.insert(4, "val4", std::chrono::hours(1));
+    ht.insert(4, "val4_upd", std::chrono::milliseconds(20));
+    ht.insert(5, "val5", std::chrono::milliseconds(20));
+    ht.insert(5, "val5_upd");
+
+    // expired item is invisible right away, and it is freed on purge
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    res = res && !ht.contains(0) && ht.contains(1) && ht.contains(2);
+    res = res && ht.contains(3) && !ht.contains(4) && ht.contains(5);
+    res = res && (ht.size_exact() == 6);
+    res = res && (ht.purge_expired() == 2);
+    res = res && (ht.size_exact() == 4) && (ht.purge_expired() == 0);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
 void Test::test_rehash()
 {
     std::cout << "rehash test:\t\t";
@@ -106,6 +204,719 @@ void Test::test_rehash()
     std::cout << (res ? "passed" : "failed") << std::endl;
 }
 
+void Test::test_size()
+{
+    std::cout << "size test:\t\t";
+
+    ConcurrentHashTable<uint16_t, std::string> ht;
+    for (uint16_t i = 0; i < CONTAINER_SIZE; ++i)
+        ht.insert(i, "val");
+    for (uint16_t i = 0; i < CONTAINER_SIZE; i += 2)
+        ht.erase(i);
+
+    bool res = (ht.size_exact() == CONTAINER_SIZE / 2);
+    res = res && (std::abs((double)ht.size() - CONTAINER_SIZE / 2) <= ht.capacity() * 0.5 / 8);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_bucket_locks()
+{
+    std::cout << "bucket locks test:\t";
+
+    ConcurrentHashTable<uint16_t, std::string, BucketLocks> ht(7, 0.5, 2.0);
+    for (uint16_t i = 0; i < 100; ++i)
+        ht.insert(i, std::to_string(i));
+    for (uint16_t i = 0; i < 100; i += 2)
+        ht.erase(i);
+
+    bool res = (ht.size_exact() == 50);
+    for (uint16_t i = 0; i < 100; ++i)
+        res = res && (ht.contains(i) == (i % 2 != 0));
+    res = res && (ht[1] == "1");
+
+    size_t count = 0;
+    ht.for_each([&](const uint16_t&, const std::string&) { count++; });
+    res = res && (count == 50);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_lock_policies()
+{
+    std::cout << "lock policies test:\t";
+
+    ConcurrentHashTable<uint16_t, std::string, ReadMostlyLocks> read_mostly(7, 0.5, 2.0);
+    ConcurrentHashTable<uint16_t, std::string, CustomLocks<DistributedRWLock, TicketLock, true, std::shared_mutex>> ticket(7, 0.5, 2.0);
+    ConcurrentHashTable<uint16_t, std::string, AdaptiveLocks> adaptive(7, 0.5, 2.0);
+    std::vector<std::thread> threads;
+    for (uint16_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&read_mostly, &ticket, &adaptive, t]()
+        {
+            std::string val;
+            for (uint16_t i = t; i < 1000; i += 4)
+            {
+                read_mostly.insert(i, std::to_string(i));
+                ticket.insert(i, std::to_string(i));
+                adaptive.insert(i, std::to_string(i));
+                read_mostly.find(i / 2, val);
+                ticket.find(i / 2, val);
+                adaptive.find(i / 2, val);
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    bool res = (read_mostly.size_exact() == 1000) && (ticket.size_exact() == 1000) && (adaptive.size_exact() == 1000);
+    for (uint16_t i = 0; i < 1000; ++i)
+        res = res && (read_mostly.at(i) == std::to_string(i)) && (ticket.at(i) == std::to_string(i)) && (adaptive.at(i) == std::to_string(i));
+
+    // long critical sections make waiters park
+    AdaptiveMutex mutex;
+    size_t counter = 0;
+    threads.clear();
+    for (uint16_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&mutex, &counter]()
+        {
+            for (size_t i = 0; i < 100; ++i)
+            {
+                std::lock_guard<AdaptiveMutex> lock(mutex);
+                std::this_thread::sleep_for(std::chrono::microseconds(10));
+                counter++;
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    res = res && (counter == 400);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_concurrent_writers()
+{
+    std::cout << "concurrent writers test:\t";
+
+    // writers of different stripes take only their stripes locks, while the table is rehashed many times
+    ConcurrentHashTable<uint32_t, uint32_t> ht(7, 0.5, 2.0, 1.0);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&ht, t]()
+        {
+            for (uint32_t i = t; i < CONTAINER_SIZE; i += 4)
+                ht.insert(i, i);
+            for (uint32_t i = t; i < CONTAINER_SIZE; i += 8)
+                ht.erase(i);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    bool res = (ht.size_exact() == CONTAINER_SIZE / 2) && (ht.capacity() > CONTAINER_SIZE);
+    for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+        res = res && (i % 8 < 4 ? !ht.contains(i) : ht.at(i) == i);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_adaptive_stripes()
+{
+    std::cout << "adaptive stripes test:\t";
+
+    // a single writer never contends, so stripes number shrinks on every rehashing down to cores number
+    ConcurrentHashTable<uint32_t, uint32_t> ht(1 << 14, 0.5, 2.0, 1.0);
+    size_t stripes_num = ht.stripes_num();
+    for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+        ht.insert(i, i);
+
+    bool res = (ht.stripes_num() < stripes_num) && (ht.stripes_num() >= std::thread::hardware_concurrency());
+    for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+        res = res && (ht.at(i) == i);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_numa()
+{
+    std::cout << "numa test:\t\t";
+
+    ConcurrentHashTable<uint16_t, std::string, StripedLocks, NumaMemory> ht;
+    for (uint16_t i = 0; i < CONTAINER_SIZE; ++i)
+        ht.insert(i, std::to_string(i));
+    for (uint16_t i = 0; i < CONTAINER_SIZE; i += 2)
+        ht.erase(i);
+    for (uint16_t i = 0; i < CONTAINER_SIZE; i += 2)
+        ht.insert(i, "val" + std::to_string(i));
+
+    bool res = (ht.size_exact() == CONTAINER_SIZE);
+    for (uint16_t i = 0; i < CONTAINER_SIZE; ++i)
+        res = res && (ht.at(i) == (i % 2 ? "" : "val") + std::to_string(i));
+
+    ReplicatedHashTable<uint16_t, std::string> replicated;
+    replicated.insert(0, "val0");
+    replicated.insert(1, "val1");
+    replicated.erase(0);
+    res = res && (replicated.replicas_num() == numa_nodes_num()) && !replicated.contains(0) && (replicated.at(1) == "val1");
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_huge_pages()
+{
+    std::cout << "huge pages test:\t";
+
+    ConcurrentHashTable<uint32_t, uint32_t, StripedLocks, HugePageMemory> ht;
+    ht.reserve(1 << 20);
+    for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+        ht.insert(i, i * 2);
+
+    bool res = (ht.size_exact() == CONTAINER_SIZE);
+    for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+        res = res && (ht.at(i) == i * 2);
+
+    // small buckets array and the first items slabs stay on regular pages
+    HugePageMemory small;
+    void* buckets = small.allocate_buckets(4096);
+    void* item = small.allocate_item(16, 8);
+    res = res && (small.buckets_pages() == PageKind::regular) && (small.slabs_pages() == PageKind::regular);
+    small.free_item(item, 16);
+    small.free_buckets(buckets, 4096);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_inline_items()
+{
+    std::cout << "inline items test:\t";
+
+    ConcurrentHashTable<uint16_t, std::string, BucketLocks, InlineItems<>> ht;
+    for (uint16_t i = 0; i < CONTAINER_SIZE; ++i)
+        ht.insert(i, std::to_string(i));
+    for (uint16_t i = 0; i < CONTAINER_SIZE; i += 3)
+        ht.erase(i);
+    ht.erase_if([](const uint16_t& key, const std::string&) { return key % 3 == 1; });
+    for (uint16_t i = 0; i < CONTAINER_SIZE; i += 3)
+        ht.insert(i, "val" + std::to_string(i));
+
+    bool res = (ht.size_exact() == CONTAINER_SIZE - (CONTAINER_SIZE + 1) / 3);
+    for (uint16_t i = 0; i < CONTAINER_SIZE; ++i)
+    {
+        if (i % 3 == 0)
+            res = res && (ht.at(i) == "val" + std::to_string(i));
+        else if (i % 3 == 1)
+            res = res && !ht.contains(i);
+        else
+            res = res && (ht.at(i) == std::to_string(i));
+    }
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_cuckoo()
+{
+    std::cout << "cuckoo test:\t\t";
+
+    CuckooHashTable<uint32_t, std::string> ht(8, 16);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&ht, t]()
+        {
+            for (uint32_t i = t; i < CONTAINER_SIZE; i += 4)
+                ht.insert(i, std::to_string(i));
+            for (uint32_t i = t; i < CONTAINER_SIZE; i += 8)
+                ht.erase(i);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    bool res = (ht.size_exact() == CONTAINER_SIZE / 2) && (ht.capacity() <= CONTAINER_SIZE * 2);
+    for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+        res = res && (i % 8 < 4 ? !ht.contains(i) : ht.at(i) == std::to_string(i));
+
+    // cuckoo paths keep the table dense, so it grows only when it is nearly full
+    CuckooHashTable<uint32_t, uint32_t> dense(CONTAINER_SIZE);
+    size_t capacity = dense.capacity();
+    uint32_t count = 0;
+    while (dense.capacity() == capacity)
+        dense.insert(count, count), count++;
+    res = res && (count > capacity * 9 / 10);
+
+    // and so it does whatever the items size is
+    CuckooHashTable<uint32_t, std::string> dense_strings(CONTAINER_SIZE);
+    capacity = dense_strings.capacity();
+    count = 0;
+    while (dense_strings.capacity() == capacity)
+        dense_strings.insert(count, std::to_string(count)), count++;
+    res = res && (count > capacity * 9 / 10);
+
+    // short cuckoo paths make the table grow at low load many times, and every grow must keep all items
+    CuckooHashTable<uint32_t, uint32_t, 4> sparse(2, 1, 2);
+    for (uint32_t i = 0; i < CONTAINER_SIZE / 25; ++i)
+        sparse.insert(i, i);
+    res = res && (sparse.size_exact() == CONTAINER_SIZE / 25);
+    for (uint32_t i = 0; i < CONTAINER_SIZE / 25; ++i)
+        res = res && (sparse.at(i) == i);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_robin_hood()
+{
+    std::cout << "robin hood test:\t";
+
+    RobinHoodHashTable<uint32_t, std::string> ht(8, 0.95f);
+    for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+        ht.insert(i, std::to_string(i));
+
+    std::thread reader([&ht]()
+    {
+        std::string val;
+        for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+            ht.find(i, val);
+    });
+    for (uint32_t i = 0; i < CONTAINER_SIZE; i += 2)
+        ht.erase(i);
+    reader.join();
+
+    bool res = (ht.size() == CONTAINER_SIZE / 2) && (ht.max_probe_length() < 32);
+    for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+        res = res && (i % 2 ? ht.at(i) == std::to_string(i) : !ht.contains(i));
+
+    size_t count = 0;
+    ht.for_each([&count](const uint32_t& key, const std::string&) { count += key % 2; });
+    res = res && (count == CONTAINER_SIZE / 2);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_hopscotch()
+{
+    std::cout << "hopscotch test:\t\t";
+
+    HopscotchHashTable<uint32_t, std::string> ht(8, 64);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&ht, t]()
+        {
+            for (uint32_t i = t; i < CONTAINER_SIZE; i += 4)
+                ht.insert(i, std::to_string(i));
+            for (uint32_t i = t; i < CONTAINER_SIZE; i += 8)
+                ht.erase(i);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    bool res = (ht.size_exact() == CONTAINER_SIZE / 2);
+    for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+        res = res && (i % 8 < 4 ? !ht.contains(i) : ht.at(i) == std::to_string(i));
+
+    size_t count = 0;
+    ht.for_each([&count](const uint32_t&, const std::string&) { count++; });
+    res = res && (count == CONTAINER_SIZE / 2);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_for_each()
+{
+    std::cout << "for_each test:\t\t";
+
+    ConcurrentHashTable<uint16_t, std::string> ht(7, 0.5, 2.0);
+    for (uint16_t i = 0; i < 100; ++i)
+        ht.insert(i, std::to_string(i));
+
+    size_t count = 0;
+    bool res = true;
+    ht.for_each([&](const uint16_t& key, const std::string& val) { count++; res = res && (val == std::to_string(key)); });
+    res = res && (count == 100);
+
+    // items which stay in hashtable are visited exactly once, while a writer keeps rehashing it,
+    // keys are spread beyond capacity, so that rehashing moves them between stripes, and every bucket is a stripe of its own
+    ConcurrentHashTable<uint32_t, uint32_t, BucketLocks> growing(7, 0.5, 2.0);
+    for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+        growing.insert(i * 64, i);
+
+    std::atomic_bool done = false;
+    std::thread writer([&growing, &done]()
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            growing.insert(i * 64 + 1, i);
+            growing.reserve(CONTAINER_SIZE + i * 1024);
+        }
+        done = true;
+    });
+    std::vector<uint32_t> visits(CONTAINER_SIZE);
+    do
+    {
+        std::fill(visits.begin(), visits.end(), 0);
+        growing.for_each([&](const uint32_t& key, const uint32_t&) { if (key % 64 == 0) visits[key / 64]++; });
+        for (uint32_t v : visits)
+            res = res && (v == 1);
+    } while (!done);
+    writer.join();
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_snapshot()
+{
+    std::cout << "snapshot test:\t\t";
+
+    ConcurrentHashTable<uint16_t, std::string> ht;
+    ht.insert(0, "val0");
+    ht.insert(1, "val1");
+    auto snapshot = ht.snapshot();
+    ht.insert(2, "val2");
+    ht[0] = "val0_upd";
+
+    bool res = (snapshot.size() == 2);
+    for (const auto& item : snapshot)
+        res = res && (item.second == "val" + std::to_string(item.first));
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_frozen()
+{
+    std::cout << "frozen test:\t\t";
+
+    ConcurrentHashTable<uint16_t, std::string> ht;
+    for (uint16_t i = 0; i < CONTAINER_SIZE; ++i)
+        ht.insert(i, std::to_string(i));
+    auto frozen = ht.freeze();
+    ht.erase(0);
+
+    bool res = (frozen.size() == CONTAINER_SIZE);
+    for (uint16_t i = 0; i < CONTAINER_SIZE; ++i)
+        res = res && (frozen.at(i) == std::to_string(i));
+
+    std::string val;
+    res = res && !frozen.contains(CONTAINER_SIZE) && !frozen.find(CONTAINER_SIZE + 1, val);
+
+    FrozenHashTable<std::string, int> empty;
+    res = res && !empty.contains("key");
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_static()
+{
+    std::cout << "static test:\t\t";
+
+    static constexpr auto opcodes = make_static_hash_table<std::string_view, int>({ { "GET", 1 }, { "PUT", 2 }, { "DELETE", 3 } });
+    static_assert(opcodes.at("PUT") == 2 && !opcodes.contains("POST"), "static hashtable is not built at compile time");
+
+    bool res = (opcodes.size() == 3) && (opcodes.at("GET") == 1) && (opcodes.at("DELETE") == 3);
+
+    int val = 0;
+    res = res && !opcodes.find("HEAD", val) && (val == 0);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_save_load()
+{
+    std::cout << "save/load test:\t\t";
+
+    const std::string path = "save_load_test.bin";
+    ConcurrentHashTable<uint16_t, std::string> ht;
+    for (uint16_t i = 0; i < CONTAINER_SIZE; ++i)
+        ht.insert(i, std::to_string(i));
+    ht.insert(CONTAINER_SIZE, "ttl", std::chrono::hours(1));
+    ht.save(path);
+
+    ConcurrentHashTable<uint16_t, std::string> loaded;
+    loaded.load(path);
+    bool res = (loaded.size_exact() == CONTAINER_SIZE + 1) && (loaded.at(CONTAINER_SIZE) == "ttl");
+    for (uint16_t i = 0; i < CONTAINER_SIZE; ++i)
+        res = res && (loaded.at(i) == std::to_string(i));
+
+    // corrupt a record
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(100);
+        file.put('#');
+    }
+
+    try
+    {
+        loaded.load(path);
+        res = false;
+    }
+    catch (const std::runtime_error&)
+    {
+        res = res && (loaded.size_exact() == 0);
+    }
+
+    std::remove(path.c_str());
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_mapped()
+{
+    std::cout << "mapped test:\t\t";
+
+    const std::string path = "mapped_test.bin";
+    ConcurrentHashTable<std::string, uint32_t> ht;
+    for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+        ht.insert("key" + std::to_string(i), i);
+    ht.save_image(path);
+
+    bool res = true;
+    {
+        MappedHashTable<std::string, uint32_t> mapped(path);
+        res = (mapped.size() == CONTAINER_SIZE) && !mapped.contains("key");
+        for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+            res = res && (mapped.at("key" + std::to_string(i)) == i);
+
+        size_t count = 0;
+        mapped.for_each([&](const std::string& key, const uint32_t& val) { count += (key == "key" + std::to_string(val)); });
+        res = res && (count == CONTAINER_SIZE);
+    }
+
+    std::remove(path.c_str());
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_durable()
+{
+    std::cout << "durable test:\t\t";
+
+    const std::string path = "durable_test";
+    bool res = true;
+    {
+        ConcurrentHashTable<uint16_t, std::string> ht;
+        ht.open_durable(path);
+
+        std::vector<std::thread> threads;
+        for (uint16_t t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&ht, t]
+            {
+                for (uint16_t i = t; i < 1000; i += 4)
+                    ht.insert(i, std::to_string(i));
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        ht.checkpoint();
+        ht.erase(0);
+        ht.insert(1, "val1_upd");
+        ht.erase_if([](const uint16_t& key, const std::string&) { return key >= 500; });
+    }
+
+    ConcurrentHashTable<uint16_t, std::string> recovered;
+    recovered.open_durable(path);
+    res = (recovered.size_exact() == 499) && !recovered.contains(0) && (recovered.at(1) == "val1_upd") && (recovered.at(499) == "499");
+    recovered.close_durable();
+
+    // items which never change are kept by checkpoints taken while a writer keeps rehashing the table,
+    // keys are spread beyond capacity, so that rehashing moves them between stripes, and every bucket is a stripe of its own
+    const std::string rehash_path = "durable_rehash_test";
+    {
+        ConcurrentHashTable<uint32_t, uint32_t, BucketLocks> ht(7, 0.5, 2.0);
+        ht.open_durable(rehash_path, false);
+        for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+            ht.insert(i * 64, i);
+        ht.checkpoint();
+
+        std::atomic_bool done = false;
+        std::thread writer([&ht, &done]()
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                ht.insert(i * 64 + 1, i);
+                ht.reserve(CONTAINER_SIZE + i * 1024);
+            }
+            done = true;
+        });
+        // every checkpoint is checked, as a later one would save items missed by an earlier one
+        ConcurrentHashTable<uint32_t, uint32_t> saved;
+        do
+        {
+            ht.checkpoint();
+            saved.load(rehash_path + ".checkpoint");
+            for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+                res = res && saved.contains(i * 64);
+        } while (!done);
+        writer.join();
+    }
+
+    ConcurrentHashTable<uint32_t, uint32_t> recovered_stable;
+    recovered_stable.open_durable(rehash_path, false);
+    res = res && (recovered_stable.size_exact() == CONTAINER_SIZE + 256);
+    for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+        res = res && recovered_stable.contains(i * 64);
+    recovered_stable.close_durable();
+
+    std::filesystem::remove(path + ".checkpoint");
+    std::filesystem::remove(path + ".wal");
+    std::filesystem::remove(rehash_path + ".checkpoint");
+    std::filesystem::remove(rehash_path + ".wal");
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_parallel()
+{
+    std::cout << "parallel test:\t\t";
+
+    ConcurrentHashTable<uint16_t, std::string> ht;
+    for (uint16_t i = 0; i < CONTAINER_SIZE; ++i)
+        ht.insert(i, std::to_string(i));
+
+    std::atomic<size_t> count = 0;
+    ht.parallel_for_each([&](const uint16_t&, const std::string&) { count++; }, 4);
+    bool res = (count == CONTAINER_SIZE);
+
+    uint64_t sum = ht.parallel_reduce([](const uint16_t& key, const std::string&) { return (uint64_t)key; },
+                                      [](uint64_t a, uint64_t b) { return a + b; }, 4);
+    res = res && (sum == (uint64_t)CONTAINER_SIZE * (CONTAINER_SIZE - 1) / 2);
+
+    // items which stay in hashtable are visited exactly once, while a writer keeps rehashing it,
+    // keys are spread beyond capacity, so that rehashing moves them between buckets
+    ConcurrentHashTable<uint32_t, uint32_t> growing(7, 0.5, 2.0);
+    for (uint32_t i = 0; i < CONTAINER_SIZE; ++i)
+        growing.insert(i * 64, i);
+
+    std::atomic_bool done = false;
+    std::thread writer([&growing, &done]()
+    {
+        for (uint32_t i = 0; i < CONTAINER_SIZE * 20; ++i)
+            growing.insert(i * 64 + 1, i);
+        done = true;
+    });
+    std::vector<std::atomic<uint32_t>> visits(CONTAINER_SIZE);
+    do
+    {
+        for (auto& v : visits)
+            v = 0;
+        growing.parallel_for_each([&](const uint32_t& key, const uint32_t&) { if (key % 64 == 0) visits[key / 64]++; }, 4);
+        for (auto& v : visits)
+            res = res && (v == 1);
+    } while (!done);
+    writer.join();
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_set()
+{
+    std::cout << "set test:\t\t";
+
+    ConcurrentHashSet<uint16_t> hs(7, 0.5, 2.0);
+    bool res = hs.insert(1);
+    res = res && !hs.insert(1);
+    for (uint16_t i = 2; i < 100; ++i)
+        hs.insert(i);
+    res = res && hs.erase(50) && !hs.erase(50);
+    res = res && (hs.size_exact() == 98) && hs.contains(1) && !hs.contains(50);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_multimap()
+{
+    std::cout << "multimap test:\t\t";
+
+    ConcurrentHashMultimap<uint16_t, std::string> hm;
+    hm.insert(0, "a");
+    hm.insert(0, "b");
+    hm.insert(1, "c");
+
+    std::vector<std::string> vals;
+    bool res = hm.find(0, vals) && (vals == std::vector<std::string>{ "a", "b" });
+    res = res && (hm.count(1) == 1) && (hm.size_exact() == 2);
+    res = res && hm.erase(0, "a") && (hm.count(0) == 1);
+    res = res && hm.erase(0, "b") && !hm.contains(0);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_counter_map()
+{
+    std::cout << "counter map test:\t";
+
+    ConcurrentCounterMap<uint16_t, uint64_t> cm;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&cm]()
+        {
+            for (uint16_t i = 0; i < 10000; ++i)
+                cm.increment(i % 100);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    bool res = (cm.size_exact() == 100);
+    for (uint16_t i = 0; i < 100; ++i)
+        res = res && (cm.get(i) == 400);
+    res = res && (cm.increment(0, 10) == 410) && (cm.get(1000) == 0);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_cache()
+{
+    std::cout << "cache test:\t\t";
+
+    ConcurrentCache<uint16_t, std::string> cache(3);
+    cache.insert(0, "val0");
+    cache.insert(1, "val1");
+    cache.insert(2, "val2");
+
+    // referenced entries get a second chance, so the only not referenced entry is evicted
+    std::string val;
+    bool res = cache.find(0, val) && (val == "val0");
+    res = res && cache.find(2, val);
+    cache.insert(3, "val3");
+    res = res && (cache.size() == 3);
+    res = res && !cache.contains(1);
+    res = res && cache.contains(0) && cache.contains(2) && (cache.at(3) == "val3");
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
+void Test::test_tiny_lfu()
+{
+    std::cout << "tiny lfu test:\t\t";
+
+    ConcurrentCache<uint16_t, std::string, WTinyLfuEviction<uint16_t>> cache(100);
+
+    // make the first 50 keys popular
+    std::string val;
+    for (uint16_t i = 0; i < 50; ++i)
+        cache.insert(i, std::to_string(i));
+    for (int round = 0; round < 5; ++round)
+        for (uint16_t i = 0; i < 50; ++i)
+            cache.find(i, val);
+
+    // scan of keys accessed once must not push popular keys out
+    for (uint16_t i = 1000; i < 2000; ++i)
+        cache.insert(i, std::to_string(i));
+
+    size_t popular = 0;
+    for (uint16_t i = 0; i < 50; ++i)
+        popular += cache.contains(i) ? 1 : 0;
+
+    bool res = (popular >= 45);
+    res = res && (cache.size() <= 100);
+
+    std::cout << (res ? "passed" : "failed") << std::endl;
+}
+
 void Test::test_multithreaded()
 {
     ConcurrentHashTable<uint16_t, std::string> ht;
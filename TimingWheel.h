@@ -0,0 +1,167 @@
+#pragma once
+
+// Hierarchical timing wheel
+// Timers are kept in 4 levels of 64 slots, level N slot spans 64^N ticks. A timer is placed into the lowest level
+// which covers its delay, and when the wheel reaches a higher level slot, its timers are cascaded to lower levels.
+// Scheduling is O(1), and advancing jumps right to the next tick with timers to expire or cascade, which is found
+// by occupied slots bitmasks of levels, so idle ticks cost nothing, and every timer costs O(1) per cascade.
+// Timers further than 64^4 ticks away are kept in an overflow list, which is rescheduled once per 64^4 ticks.
+// The class is not thread safe.
+template <class KeyType>
+class TimingWheel
+{
+public:
+    explicit TimingWheel(const uint64_t now_tick) noexcept : _current(now_tick) {}
+
+    void schedule(const KeyType& key, const uint64_t expires);
+    template <class Func> void advance(const uint64_t now_tick, Func expire);
+    void clear() noexcept;
+    size_t size() const noexcept { return _timers_num; }
+    uint64_t current() const noexcept { return _current; }
+
+private:
+    struct Timer
+    {
+        KeyType _key;
+        uint64_t _expires;                                  // expiration tick
+    };
+
+    static const size_t _levels = 4;                        // levels number
+    static const size_t _slot_bits = 6;                     // log2 of slots number per level
+    static const uint64_t _slot_mask = (1 << _slot_bits) - 1;
+
+    std::vector<Timer> _wheel[_levels][(size_t)1 << _slot_bits]; // timers slots
+    std::vector<Timer> _overflow;                           // timers beyond the last level
+    uint64_t _occupied[_levels] = {};                       // non-empty slots bitmasks of levels
+    uint64_t _current;                                      // last processed tick
+    size_t _timers_num = 0;                                 // scheduled timers number
+
+    void place(Timer&& timer, const uint64_t tick);
+    void cascade(std::vector<Timer>& slot);
+    uint64_t next_tick() const noexcept;
+};
+
+// schedule timer
+// timer which is already due expires on the next tick
+// @key - timer key
+// @expires - expiration tick
+template <class KeyType>
+void TimingWheel<KeyType>::schedule(const KeyType& key, const uint64_t expires)
+{
+    place(Timer{ key, expires }, std::max(expires, _current + 1));
+    _timers_num++;
+}
+
+// advance wheel up to specified tick and expire due timers
+// @now_tick - current tick
+// @expire - called as expire(const KeyType& key, uint64_t expires) for every due timer
+template <class KeyType>
+template <class Func>
+void TimingWheel<KeyType>::advance(const uint64_t now_tick, Func expire)
+{
+    while (_current < now_tick)
+    {
+        // nothing to expire or cascade before the current tick, jump right to it
+        uint64_t next = next_tick();
+        if (next > now_tick)
+        {
+            _current = now_tick;
+            return;
+        }
+
+        _current = next;
+
+        // cascade timers of every level whose slot boundary is reached, higher levels first,
+        // so that timers cascaded from a higher level are cascaded further down on the same tick
+        size_t level = 0;
+        while (level < _levels && !(_current & ((1ull << (_slot_bits * (level + 1))) - 1)))
+            level++;
+
+        if (level == _levels)
+            cascade(_overflow);
+
+        for (size_t l = std::min(level, _levels - 1); l > 0; --l)
+        {
+            size_t slot = (_current >> (_slot_bits * l)) & _slot_mask;
+            _occupied[l] &= ~(1ull << slot);
+            cascade(_wheel[l][slot]);
+        }
+
+        // expire timers of the current tick
+        std::vector<Timer> due;
+        due.swap(_wheel[0][_current & _slot_mask]);
+        _occupied[0] &= ~(1ull << (_current & _slot_mask));
+        _timers_num -= due.size();
+        for (const Timer& timer : due)
+            expire(timer._key, timer._expires);
+    }
+}
+
+// remove all timers
+template <class KeyType>
+void TimingWheel<KeyType>::clear() noexcept
+{
+    for (auto& level : _wheel)
+        for (auto& slot : level)
+            slot.clear();
+    _overflow.clear();
+    for (auto& occupied : _occupied)
+        occupied = 0;
+    _timers_num = 0;
+}
+
+// place timer into the lowest level covering its delay
+// @timer - timer
+// @tick - tick to fire timer at, not earlier than the current one, timer cascaded right at its tick fires on the current tick
+template <class KeyType>
+void TimingWheel<KeyType>::place(Timer&& timer, const uint64_t tick)
+{
+    uint64_t delay = tick - _current;
+
+    for (size_t level = 0; level < _levels; ++level)
+    {
+        if (delay < (1ull << (_slot_bits * (level + 1))))
+        {
+            size_t slot = (tick >> (_slot_bits * level)) & _slot_mask;
+            _wheel[level][slot].push_back(std::move(timer));
+            _occupied[level] |= 1ull << slot;
+            return;
+        }
+    }
+
+    _overflow.push_back(std::move(timer));
+}
+
+// move slot timers to lower levels
+// @slot - slot to cascade
+template <class KeyType>
+void TimingWheel<KeyType>::cascade(std::vector<Timer>& slot)
+{
+    std::vector<Timer> timers;
+    timers.swap(slot);
+    for (Timer& timer : timers)
+        place(std::move(timer), std::max(timer._expires, _current));
+}
+
+// get the next tick at which some slot is due, either to expire its timers or to cascade them
+// slots of a level are due in circular order starting right after the slot of the current tick
+template <class KeyType>
+uint64_t TimingWheel<KeyType>::next_tick() const noexcept
+{
+    // overflow list is rescheduled when the last level completes its rotation
+    uint64_t next = _overflow.empty() ? std::numeric_limits<uint64_t>::max() : ((_current >> (_slot_bits * _levels)) + 1) << (_slot_bits * _levels);
+
+    for (size_t level = 0; level < _levels; ++level)
+    {
+        if (!_occupied[level])
+            continue;
+
+        uint64_t slot_tick = _current >> (_slot_bits * level);
+        size_t distance = 1;
+        while (!((_occupied[level] >> ((slot_tick + distance) & _slot_mask)) & 1))
+            distance++;
+        next = std::min(next, (slot_tick + distance) << (_slot_bits * level));
+    }
+
+    return next;
+}
@@ -0,0 +1,265 @@
+#pragma once
+#include "ConcurrentCache.h"
+#include "StripedCounter.h"
+#include "FrequencySketch.h"
+
+// W-TinyLFU eviction policy
+// New entries are placed into a small LRU window, entries leaving the window compete with the main region
+// LRU victim and are admitted only if they were accessed more often according to the frequency sketch.
+// Main region is a segmented LRU: entries hit while on probation are promoted to the protected segment.
+// Hits are recorded into striped read buffers and applied to the sketch and LRU lists in batches,
+// so the hit path takes only an uncontended buffer mutex, and drops the hit if the buffer is busy.
+template <class KeyType>
+class WTinyLfuEviction
+{
+public:
+    struct Handle {};                                       // entries are looked up by key, no handle is needed
+
+    explicit WTinyLfuEviction(const size_t capacity);
+
+    // called concurrently on hit
+    void on_hit(const KeyType& key, const Handle handle) noexcept;
+
+    // called under cache write lock
+    Handle on_insert(const KeyType& key, std::vector<KeyType>& evicted);
+    void on_erase(const KeyType& key, const Handle handle) noexcept;
+    void clear() noexcept;
+
+private:
+    enum class Queue { Window, Probation, Protected };
+
+    struct Node
+    {
+        Queue _queue;
+        typename std::list<KeyType>::iterator _pos;
+    };
+
+    // buffer of recent hits, padded to a cache line to avoid false sharing between threads
+    struct alignas(64) ReadBuffer
+    {
+        std::mutex _mutex;
+        std::vector<KeyType> _keys;
+    };
+
+    static const size_t _read_buffer_size = 32;             // hits number buffered before they are applied
+
+    size_t _window_capacity;                                // window LRU capacity
+    size_t _protected_capacity;                             // protected segment capacity
+    size_t _main_capacity;                                  // main region (probation and protected) capacity
+    std::hash<KeyType> _hash_func;
+
+    std::mutex _mutex;                                      // protects sketch and LRU lists
+    FrequencySketch _sketch;                                // keys access frequencies
+    std::list<KeyType> _window;                             // window LRU, most recent first
+    std::list<KeyType> _probation;                          // main region probation segment, most recent first
+    std::list<KeyType> _protected;                          // main region protected segment, most recent first
+    std::unordered_map<KeyType, Node> _nodes;               // entries positions in LRU lists
+
+    size_t _read_buffers_num;                               // read buffers number
+    std::unique_ptr<ReadBuffer[]> _read_buffers;            // striped read buffers
+
+    void drain(ReadBuffer& buffer) noexcept;
+    void on_access(const KeyType& key) noexcept;
+    std::list<KeyType>& queue(const Queue queue) noexcept;
+    void move(Node& node, const Queue to) noexcept;
+    void remove(const KeyType& key) noexcept;
+};
+
+// constructor
+// window takes 1% of capacity, protected segment takes 80% of the main region
+// @capacity - maximal entries number
+template <class KeyType>
+WTinyLfuEviction<KeyType>::WTinyLfuEviction(const size_t capacity) :
+    _window_capacity(std::max<size_t>(1, capacity / 100)),
+    _protected_capacity(0),
+    _main_capacity(0),
+    _sketch(capacity),
+    _read_buffers_num(std::max(1u, std::thread::hardware_concurrency())),
+    _read_buffers(new ReadBuffer[_read_buffers_num])
+{
+    _main_capacity = capacity > _window_capacity ? capacity - _window_capacity : 0;
+    _protected_capacity = _main_capacity * 8 / 10;
+
+    for (size_t i = 0; i < _read_buffers_num; ++i)
+        _read_buffers[i]._keys.reserve(_read_buffer_size);
+}
+
+// record hit into the calling thread read buffer, and apply buffered hits when the buffer is full
+// hit is dropped if the buffer is busy or full while the policy is busy, which only makes frequencies slightly less precise
+// @key - entry key
+template <class KeyType>
+void WTinyLfuEviction<KeyType>::on_hit(const KeyType& key, const Handle) noexcept
+{
+    ReadBuffer& buffer = _read_buffers[thread_index() % _read_buffers_num];
+
+    std::unique_lock<std::mutex> buffer_lock(buffer._mutex, std::try_to_lock);
+    if (!buffer_lock.owns_lock())
+        return;
+
+    if (buffer._keys.size() < _read_buffer_size)
+        buffer._keys.push_back(key);
+
+    if (buffer._keys.size() >= _read_buffer_size)
+    {
+        std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+        if (lock.owns_lock())
+            drain(buffer);
+    }
+}
+
+// place new entry into the window and run admission of the entry leaving the window
+// all buffered hits are applied only if some entry is going to be evicted, so that admission sees up to date frequencies,
+// otherwise only full buffers are applied, which hits couldn't apply while the policy was busy
+// @key - new entry key
+// @evicted - will contain keys of evicted entries
+template <class KeyType>
+typename WTinyLfuEviction<KeyType>::Handle WTinyLfuEviction<KeyType>::on_insert(const KeyType& key, std::vector<KeyType>& evicted)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // applying hits only reorders entries within regions, so regions sizes tell whether eviction is needed
+    bool evicting = _window.size() + 1 > _window_capacity && _probation.size() + _protected.size() + 1 > _main_capacity;
+    for (size_t i = 0; i < _read_buffers_num; ++i)
+    {
+        std::unique_lock<std::mutex> buffer_lock(_read_buffers[i]._mutex, std::defer_lock);
+        if (evicting)
+            buffer_lock.lock();
+        else if (!buffer_lock.try_lock() || _read_buffers[i]._keys.size() < _read_buffer_size)
+            continue;
+
+        drain(_read_buffers[i]);
+    }
+
+    _sketch.increment(_hash_func(key));
+    _window.push_front(key);
+    _nodes[key] = Node{ Queue::Window, _window.begin() };
+
+    if (_window.size() <= _window_capacity)
+        return Handle();
+
+    // window LRU entry becomes a candidate for the main region
+    KeyType candidate = _window.back();
+    move(_nodes[candidate], Queue::Probation);
+
+    if (_probation.size() + _protected.size() <= _main_capacity)
+        return Handle();
+
+    // main region is full, so either candidate or main region victim is evicted, whichever is less frequent
+    KeyType loser = candidate;
+    if (_main_capacity)
+    {
+        const KeyType& victim = _probation.size() > 1 ? _probation.back() : _protected.back();
+        if (_sketch.frequency(_hash_func(candidate)) > _sketch.frequency(_hash_func(victim)))
+            loser = victim;
+    }
+
+    evicted.push_back(loser);
+    remove(loser);
+    return Handle();
+}
+
+// forget entry
+// @key - entry key
+template <class KeyType>
+void WTinyLfuEviction<KeyType>::on_erase(const KeyType& key, const Handle) noexcept
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    remove(key);
+}
+
+// forget all entries and frequencies
+template <class KeyType>
+void WTinyLfuEviction<KeyType>::clear() noexcept
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (size_t i = 0; i < _read_buffers_num; ++i)
+    {
+        std::lock_guard<std::mutex> buffer_lock(_read_buffers[i]._mutex);
+        _read_buffers[i]._keys.clear();
+    }
+
+    _sketch.clear();
+    _window.clear();
+    _probation.clear();
+    _protected.clear();
+    _nodes.clear();
+}
+
+// apply buffered hits
+// must be called under policy mutex and buffer mutex
+// @buffer - read buffer
+template <class KeyType>
+void WTinyLfuEviction<KeyType>::drain(ReadBuffer& buffer) noexcept
+{
+    for (const KeyType& key : buffer._keys)
+    {
+        _sketch.increment(_hash_func(key));
+        on_access(key);
+    }
+    buffer._keys.clear();
+}
+
+// move accessed entry to the head of its LRU list, promoting it from probation to protected segment
+// must be called under policy mutex
+// @key - entry key
+template <class KeyType>
+void WTinyLfuEviction<KeyType>::on_access(const KeyType& key) noexcept
+{
+    auto it = _nodes.find(key);
+    if (it == _nodes.end())
+        return;
+
+    Node& node = it->second;
+    if (node._queue != Queue::Probation)
+    {
+        move(node, node._queue);
+        return;
+    }
+
+    move(node, Queue::Protected);
+
+    // demote protected LRU entry if protected segment overflowed
+    if (_protected.size() > _protected_capacity)
+        move(_nodes[_protected.back()], Queue::Probation);
+}
+
+// get LRU list of queue
+// @queue - queue type
+template <class KeyType>
+std::list<KeyType>& WTinyLfuEviction<KeyType>::queue(const Queue queue) noexcept
+{
+    switch (queue)
+    {
+        case Queue::Window:    return _window;
+        case Queue::Probation: return _probation;
+        default:               return _protected;
+    }
+}
+
+// move entry to the head of LRU list
+// must be called under policy mutex
+// @node - entry node
+// @to - destination queue
+template <class KeyType>
+void WTinyLfuEviction<KeyType>::move(Node& node, const Queue to) noexcept
+{
+    std::list<KeyType>& dst = queue(to);
+    dst.splice(dst.begin(), queue(node._queue), node._pos);
+    node._queue = to;
+    node._pos = dst.begin();
+}
+
+// remove entry from LRU lists
+// must be called under policy mutex
+// @key - entry key
+template <class KeyType>
+void WTinyLfuEviction<KeyType>::remove(const KeyType& key) noexcept
+{
+    auto it = _nodes.find(key);
+    if (it == _nodes.end())
+        return;
+
+    queue(it->second._queue).erase(it->second._pos);
+    _nodes.erase(it);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+// Work stealing scheduler of an index range
+// The range is split into chunks and every worker initially owns an equal contiguous share of them.
+// Worker takes chunks from the front of its own share, and when it runs out of chunks it steals
+// the back half of another worker's share, so workers with cheap chunks help the ones with expensive chunks.
+class WorkStealingRange
+{
+public:
+    WorkStealingRange(const size_t begin, const size_t end, const size_t chunk_size, const size_t workers_num);
+
+    bool next(const size_t worker_idx, size_t& chunk_begin, size_t& chunk_end) noexcept;
+    size_t workers_num() const noexcept { return _workers_num; }
+
+private:
+    // worker's share of chunks, padded to a cache line to avoid false sharing between workers
+    struct alignas(64) Share
+    {
+        std::mutex _mutex;
+        size_t _begin = 0;                                  // first chunk of the share
+        size_t _end = 0;                                    // past the last chunk of the share
+    };
+
+    size_t _begin;                                          // range begin
+    size_t _end;                                            // range end
+    size_t _chunk_size;                                     // indexes number in a chunk
+    size_t _workers_num;                                    // workers number
+    std::unique_ptr<Share[]> _shares;                       // workers shares
+
+    bool steal(const size_t worker_idx) noexcept;
+};
+
+// constructor
+// @begin - range begin
+// @end - range end
+// @chunk_size - indexes number in a chunk
+// @workers_num - workers number
+inline WorkStealingRange::WorkStealingRange(const size_t begin, const size_t end, const size_t chunk_size, const size_t workers_num) :
+    _begin(begin),
+    _end(end),
+    _chunk_size(chunk_size ? chunk_size : 1),
+    _workers_num(workers_num ? workers_num : 1),
+    _shares(new Share[_workers_num])
+{
+    // split chunks between workers evenly
+    size_t chunks_num = (_end - _begin + _chunk_size - 1) / _chunk_size;
+    for (size_t i = 0; i < _workers_num; ++i)
+    {
+        _shares[i]._begin = chunks_num * i / _workers_num;
+        _shares[i]._end = chunks_num * (i + 1) / _workers_num;
+    }
+}
+
+// get next chunk to process
+// @worker_idx - index of calling worker
+// @chunk_begin - will contain chunk begin
+// @chunk_end - will contain chunk end
+// returns false if there are no chunks left
+inline bool WorkStealingRange::next(const size_t worker_idx, size_t& chunk_begin, size_t& chunk_end) noexcept
+{
+    Share& share = _shares[worker_idx];
+
+    do
+    {
+        std::lock_guard<std::mutex> lock(share._mutex);
+        if (share._begin < share._end)
+        {
+            size_t chunk = share._begin++;
+            chunk_begin = _begin + chunk * _chunk_size;
+            chunk_end = std::min(chunk_begin + _chunk_size, _end);
+            return true;
+        }
+    } while (steal(worker_idx));
+
+    return false;
+}
+
+// steal half of chunks from another worker
+// chunks are never added back, so if all shares are empty at the moment, the work is done
+// @worker_idx - index of stealing worker
+inline bool WorkStealingRange::steal(const size_t worker_idx) noexcept
+{
+    for (size_t i = 1; i < _workers_num; ++i)
+    {
+        Share& victim = _shares[(worker_idx + i) % _workers_num];
+
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim._mutex);
+            if (victim._begin >= victim._end)
+                continue;
+
+            // take the back half, the victim keeps working on the front
+            size_t middle = victim._begin + (victim._end - victim._begin) / 2;
+            begin = middle;
+            end = victim._end;
+            victim._end = middle;
+        }
+
+        std::lock_guard<std::mutex> lock(_shares[worker_idx]._mutex);
+        _shares[worker_idx]._begin = begin;
+        _shares[worker_idx]._end = end;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,277 @@
+#pragma once
+#include "StripedCounter.h"
+#include "Serializer.h"
+
+// Group committed write-ahead log
+// Every thread appends records to its own buffer, a log writer thread periodically merges all buffers into the log file
+// and syncs it to disk, so a single sync makes durable all records appended since the previous one.
+// Records get increasing log sequence numbers (LSN) at append, so replay restores their order however buffers were merged.
+// Record format: uint32_t payload length, uint64_t LSN, payload, uint64_t checksum of LSN and payload.
+// In synchronous commit mode commit waits until the record is synced, otherwise records synced within a flush interval might be lost.
+class WriteAheadLog
+{
+public:
+    WriteAheadLog(const std::string& path,
+                  const uint64_t next_lsn = 1,
+                  const bool sync_commit = true,
+                  const std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1),
+                  const size_t buffers_num = std::thread::hardware_concurrency());
+    ~WriteAheadLog() noexcept;
+
+    uint64_t append(const std::string_view payload);
+    void commit(const uint64_t lsn);
+    void rotate(const std::string& old_path);
+
+    template <class Func> static bool replay(const std::string& path, Func fn);
+    static void sync_file(const std::string& path);
+
+private:
+    // thread buffer, padded to a cache line to avoid false sharing
+    struct alignas(64) Buffer
+    {
+        std::mutex _mutex;
+        std::string _data;
+    };
+
+    std::string _path;                                      // log file path
+    std::FILE* _file = nullptr;                             // log file
+    bool _sync_commit;                                      // whether commit waits for sync
+    std::chrono::milliseconds _flush_interval;              // log writer thread flush interval
+    std::unique_ptr<Buffer[]> _buffers;                     // threads buffers
+    size_t _buffers_num;                                    // threads buffers number
+    std::atomic<uint64_t> _next_lsn;                        // next record LSN
+    std::atomic<uint64_t> _durable_lsn;                     // all records up to this LSN are synced
+    std::atomic<bool> _failed{false};                       // whether log file write failed
+    std::mutex _file_mutex;                                 // protects log file
+    std::string _write_data;                                // merged buffers, protected by file mutex
+    std::mutex _writer_mutex;                               // protects log writer state below
+    std::condition_variable _writer_cv;                     // wakes log writer thread up
+    std::condition_variable _durable_cv;                    // wakes committing threads up
+    bool _flush_requested = false;                          // whether a committing thread waits for sync
+    bool _stop = false;                                     // whether log writer thread should stop
+    std::thread _writer;                                    // log writer thread
+
+    void writer_func();
+    void flush();
+    static bool sync_file(std::FILE* file) noexcept;
+};
+
+// constructor, opens log file for appending and starts log writer thread
+// @path - log file path
+// @next_lsn - LSN of the first appended record, should follow the last replayed one
+// @sync_commit - whether commit waits until record is synced
+// @flush_interval - log writer thread flush interval
+// @buffers_num - threads buffers number, usually the number of cores
+inline WriteAheadLog::WriteAheadLog(const std::string& path,
+                                    const uint64_t next_lsn,
+                                    const bool sync_commit,
+                                    const std::chrono::milliseconds flush_interval,
+                                    const size_t buffers_num) :
+    _path(path),
+    _sync_commit(sync_commit),
+    _flush_interval(flush_interval),
+    _buffers_num(buffers_num ? buffers_num : 1),
+    _next_lsn(next_lsn),
+    _durable_lsn(next_lsn - 1)
+{
+    _file = std::fopen(_path.c_str(), "ab");
+    if (!_file)
+        throw std::runtime_error("Failed to open file " + _path);
+
+    _buffers.reset(new Buffer[_buffers_num]);
+    _writer = std::thread(&WriteAheadLog::writer_func, this);
+}
+
+// destructor, syncs all appended records and stops log writer thread
+inline WriteAheadLog::~WriteAheadLog() noexcept
+{
+    {
+        std::lock_guard<std::mutex> writer_lock(_writer_mutex);
+        _stop = true;
+    }
+    _writer_cv.notify_one();
+    _writer.join();
+
+    std::fclose(_file);
+}
+
+// append record to the calling thread buffer
+// @payload - record payload
+// returns record LSN
+inline uint64_t WriteAheadLog::append(const std::string_view payload)
+{
+    Buffer& buffer = _buffers[thread_index() % _buffers_num];
+    std::lock_guard<std::mutex> buffer_lock(buffer._mutex);
+
+    // LSN is taken under buffer lock, so records with smaller LSNs are in buffers once log writer locks them
+    uint64_t lsn = _next_lsn.fetch_add(1, std::memory_order_relaxed);
+
+    size_t record_pos = buffer._data.size();
+    Serializer<uint32_t>::write(buffer._data, (uint32_t)payload.size());
+    Serializer<uint64_t>::write(buffer._data, lsn);
+    buffer._data.append(payload);
+
+    Checksum checksum;
+    checksum.update(buffer._data.data() + record_pos + sizeof(uint32_t), sizeof(uint64_t) + payload.size());
+    Serializer<uint64_t>::write(buffer._data, checksum.value());
+
+    return lsn;
+}
+
+// wait until record is synced in synchronous commit mode, return at once otherwise
+// @lsn - record LSN
+inline void WriteAheadLog::commit(const uint64_t lsn)
+{
+    if (!_sync_commit || _durable_lsn.load(std::memory_order_acquire) >= lsn)
+        return;
+
+    // ask log writer to flush now instead of waiting for the flush interval
+    std::unique_lock<std::mutex> writer_lock(_writer_mutex);
+    _flush_requested = true;
+    _writer_cv.notify_one();
+    _durable_cv.wait(writer_lock, [&] { return _durable_lsn.load(std::memory_order_acquire) >= lsn || _failed.load(); });
+
+    if (_failed.load())
+        throw std::runtime_error("Failed to write file " + _path);
+}
+
+// sync all appended records and move log file to another path, then continue with a new empty log file
+// records appended after rotation started might get to either file
+// @old_path - path to move log file to
+inline void WriteAheadLog::rotate(const std::string& old_path)
+{
+    std::lock_guard<std::mutex> file_lock(_file_mutex);
+    flush();
+
+    std::fclose(_file);
+    std::filesystem::rename(_path, old_path);
+    _file = std::fopen(_path.c_str(), "ab");
+    if (!_file)
+    {
+        _failed = true;
+        _durable_cv.notify_all();
+        throw std::runtime_error("Failed to open file " + _path);
+    }
+}
+
+// read all records of a log file, stops at the first torn or corrupted record, which is the log tail written during crash
+// @path - log file path
+// @fn - visitor, called as fn(uint64_t lsn, std::string_view payload)
+// returns false if log file doesn't exist
+template <class Func>
+bool WriteAheadLog::replay(const std::string& path, Func fn)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    std::string record;
+    for (;;)
+    {
+        char len_data[sizeof(uint32_t)];
+        if (!file.read(len_data, sizeof(len_data)))
+            break;
+
+        uint32_t len = 0;
+        const char* pos = len_data;
+        Serializer<uint32_t>::read(pos, len_data + sizeof(len_data), len);
+
+        record.resize(sizeof(uint64_t) + len + sizeof(uint64_t));
+        if (!file.read(&record[0], record.size()))
+            break;
+
+        uint64_t lsn = 0, saved_checksum = 0;
+        pos = record.data();
+        const char* end = record.data() + record.size();
+        Serializer<uint64_t>::read(pos, end, lsn);
+        const char* checksum_pos = end - sizeof(uint64_t);
+        Serializer<uint64_t>::read(checksum_pos, end, saved_checksum);
+
+        Checksum checksum;
+        checksum.update(record.data(), sizeof(uint64_t) + len);
+        if (checksum.value() != saved_checksum)
+            break;
+
+        fn(lsn, std::string_view(pos, len));
+    }
+
+    return true;
+}
+
+// flush file data to disk, e.g. before the file is used to drop a log
+// @path - file path
+inline void WriteAheadLog::sync_file(const std::string& path)
+{
+    std::FILE* file = std::fopen(path.c_str(), "ab");
+    bool synced = file && sync_file(file);
+    if (file)
+        std::fclose(file);
+
+    if (!synced)
+        throw std::runtime_error("Failed to sync file " + path);
+}
+
+// log writer thread function
+inline void WriteAheadLog::writer_func()
+{
+    std::unique_lock<std::mutex> writer_lock(_writer_mutex);
+    while (!_stop)
+    {
+        _writer_cv.wait_for(writer_lock, _flush_interval, [&] { return _stop || _flush_requested; });
+        _flush_requested = false;
+        writer_lock.unlock();
+
+        {
+            std::lock_guard<std::mutex> file_lock(_file_mutex);
+            flush();
+        }
+
+        writer_lock.lock();
+    }
+
+    writer_lock.unlock();
+    std::lock_guard<std::mutex> file_lock(_file_mutex);
+    flush();
+}
+
+// merge threads buffers, write them to log file and sync it, must be called under file lock
+inline void WriteAheadLog::flush()
+{
+    // every record with a smaller LSN is in a buffer already
+    uint64_t durable_lsn = _next_lsn.load(std::memory_order_relaxed) - 1;
+
+    for (size_t i = 0; i < _buffers_num; ++i)
+    {
+        std::lock_guard<std::mutex> buffer_lock(_buffers[i]._mutex);
+        _write_data.append(_buffers[i]._data);
+        _buffers[i]._data.clear();
+    }
+
+    if (!_write_data.empty())
+    {
+        bool written = std::fwrite(_write_data.data(), 1, _write_data.size(), _file) == _write_data.size() && sync_file(_file);
+        _write_data.clear();
+        if (!written)
+            _failed = true;
+    }
+
+    {
+        std::lock_guard<std::mutex> writer_lock(_writer_mutex);
+        if (!_failed.load())
+            _durable_lsn.store(durable_lsn, std::memory_order_release);
+    }
+    _durable_cv.notify_all();
+}
+
+// flush file buffers to disk
+// @file - file to sync
+inline bool WriteAheadLog::sync_file(std::FILE* file) noexcept
+{
+    if (std::fflush(file) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
@@ -1,5 +1,15 @@
 #include "stdafx.h"
 #include "ConcurrentHashTable.h"
+#include "ConcurrentHashSet.h"
+#include "ConcurrentHashMultimap.h"
+#include "ConcurrentCounterMap.h"
+#include "ConcurrentCache.h"
+#include "WTinyLfuEviction.h"
+#include "StaticHashTable.h"
+#include "ReplicatedHashTable.h"
+#include "CuckooHashTable.h"
+#include "RobinHoodHashTable.h"
+#include "HopscotchHashTable.h"
 #include "Test.h"
 
 int main()
@@ -10,7 +10,40 @@
 #include <unordered_map>
 #include <conio.h>
 #include <deque>
+#include <list>
 #include <shared_mutex>
 #include <atomic>
 #include <iostream>
 #include <ctime>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <optional>
+#include <type_traits>
+#include <string_view>
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+#include <cctype>
+#include <filesystem>
+#include <condition_variable>
+#include <limits>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#pragma comment(lib, "Synchronization.lib")
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#endif
+#endif
+#include <algorithm>
+#include <cmath>